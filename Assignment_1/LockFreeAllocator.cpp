@@ -0,0 +1,277 @@
+/**
+ * @file LockFreeAllocator.cpp
+ * @author Diego Lopez (diego.lopez@digipen.edu)
+ * @brief Lock free fixed size allocator with a tagged Treiber stack free list
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "LockFreeAllocator.h"
+#include <exception>
+#include <thread>
+
+// The version lives in the bits of the word the pointer doesn't use: the top
+// 16 bits of a 64 bit address (user space uses 48), or a whole 32 bit half
+static const unsigned      TAG_SHIFT    = sizeof(void*) == 8 ? 48 : 32;
+static const std::uint64_t POINTER_MASK = (static_cast<std::uint64_t>(1) << TAG_SHIFT) - 1;
+
+static_assert(sizeof(std::atomic<GenericObject*>) == sizeof(GenericObject*), "the Next link of a block is read as an atomic");
+
+/**
+ * @brief Builds a free list head out of a pointer and a version
+ *
+ * @param Object block at the top of the free list
+ * @param Tag version, only the bits that fit are kept
+ * @return Tagged packed head
+ */
+LockFreeAllocator::Tagged LockFreeAllocator::Pack(GenericObject* Object, Tagged Tag)
+{
+    return (Tag << TAG_SHIFT) | (static_cast<Tagged>(reinterpret_cast<std::uintptr_t>(Object)) & POINTER_MASK);
+}
+
+/**
+ * @brief Object part of a free list head
+ *
+ * @param Head packed head
+ * @return GenericObject* block at the top of the free list
+ */
+GenericObject* LockFreeAllocator::Pointer(Tagged Head)
+{
+    return reinterpret_cast<GenericObject*>(static_cast<std::uintptr_t>(Head & POINTER_MASK));
+}
+
+/**
+ * @brief Version part of a free list head
+ *
+ * @param Head packed head
+ * @return Tagged version
+ */
+LockFreeAllocator::Tagged LockFreeAllocator::Tag(Tagged Head)
+{
+    return Head >> TAG_SHIFT;
+}
+
+/**
+ * @brief Next link of a block, threads may read it while another one writes it
+ *
+ * @param Object block
+ * @return std::atomic<GenericObject*>& its Next field
+ */
+std::atomic<GenericObject*>& LockFreeAllocator::Link(GenericObject* Object)
+{
+    return *reinterpret_cast<std::atomic<GenericObject*>*>(&Object->Next);
+}
+
+/**
+ * @brief Construct a new Lock Free Allocator object
+ *      Throws an exception if the objects can't hold an aligned free list link. (Bad boundary)
+ *
+ * @param ObjectSize Size of the object
+ * @param config configuration of the allocator
+ */
+LockFreeAllocator::LockFreeAllocator(size_t ObjectSize, const OAConfig& config) :
+    configuration_(config), objectSize_(ObjectSize), FreeList_(0), PageList_(nullptr),
+    pages_(0), published_(0), allocations_(0), deallocations_(0), mostObjects_(0)
+{
+    //Blocks follow the page link back to back, so the size decides whether every one of them is aligned
+    if (ObjectSize < sizeof(void*) || ObjectSize % alignof(std::atomic<GenericObject*>))
+        throw OAException(OAException::E_BAD_BOUNDARY, "Objects must hold a pointer and keep the next one aligned for it");
+
+    //Same layout as ObjectAllocator without headers, pads or alignment
+    configuration_.PadBytes_ = 0;
+    configuration_.HBlockInfo_ = OAConfig::HeaderBlockInfo();
+    configuration_.Alignment_ = 0;
+    configuration_.LeftAlignSize_ = 0;
+    configuration_.InterAlignSize_ = 0;
+    pageSize_ = sizeof(void*) + configuration_.ObjectsPerPage_ * objectSize_;
+
+    //Create First Page
+    CreatePage();
+}
+
+/**
+ * @brief Destroys every page (never throws)
+ *
+ */
+LockFreeAllocator::~LockFreeAllocator()
+{
+    GenericObject* page = PageList_.load();
+    while (page)
+    {
+        GenericObject* temp = page;
+        page = page->Next;
+        delete[] reinterpret_cast<char*>(temp);
+    }
+}
+
+/**
+ * @brief Creates a page, links its blocks privately and publishes the whole chain with one CAS
+ *
+ * @return true if the page was created
+ * @return false if MaxPages_ was already reached
+ */
+bool LockFreeAllocator::CreatePage(void)
+{
+    //Reserve the page first so racing threads can't go over MaxPages_
+    unsigned count = pages_.load(std::memory_order_relaxed);
+    do
+    {
+        if (configuration_.MaxPages_ && count >= configuration_.MaxPages_)
+            return false;
+    } while (!pages_.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+
+    //Allocate
+    char* Block;
+    try {
+        Block = new char[pageSize_];
+    }
+    catch (const std::exception&)
+    {
+        pages_.fetch_sub(1, std::memory_order_relaxed);
+        throw OAException(OAException::E_NO_MEMORY, "There is no memory, error when using new");
+    }
+
+    //The head only keeps the low bits of a pointer
+    if (reinterpret_cast<std::uintptr_t>(Block + pageSize_) - 1 > POINTER_MASK)
+    {
+        delete[] Block;
+        pages_.fetch_sub(1, std::memory_order_relaxed);
+        throw OAException(OAException::E_NO_MEMORY, "The page is above the addresses the free list head can hold");
+    }
+
+    //Page List append
+    GenericObject* page = reinterpret_cast<GenericObject*>(Block);
+    page->Next = PageList_.load(std::memory_order_relaxed);
+    while (!PageList_.compare_exchange_weak(page->Next, page, std::memory_order_release, std::memory_order_relaxed))
+        ;
+
+    //Chain the blocks, nobody else can see them yet
+    char* first = Block + sizeof(void*);
+    GenericObject* tail = reinterpret_cast<GenericObject*>(first);
+    GenericObject* top = tail;
+    for (unsigned i = 1; i < configuration_.ObjectsPerPage_; i++)
+    {
+        GenericObject* object = reinterpret_cast<GenericObject*>(first + i * objectSize_);
+        object->Next = top;
+        top = object;
+    }
+
+    //Publish
+    Tagged head = FreeList_.load(std::memory_order_relaxed);
+    do
+    {
+        Link(tail).store(Pointer(head), std::memory_order_relaxed);
+    } while (!FreeList_.compare_exchange_weak(head, Pack(top, Tag(head) + 1), std::memory_order_release, std::memory_order_relaxed));
+    published_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Pops an object from the free list (simulates new)
+ *      Throws an exception if the object can't be allocated. (Memory allocation problem)
+ *
+ * @return void* pointer to the allocated memory
+ */
+void* LockFreeAllocator::Allocate(void)
+{
+    Tagged head = FreeList_.load(std::memory_order_acquire);
+    for (;;)
+    {
+        GenericObject* object = Pointer(head);
+        if (!object)
+        {
+            //Out of pages only when no other thread is still creating one
+            if (!CreatePage())
+            {
+                if (published_.load(std::memory_order_acquire) < pages_.load(std::memory_order_relaxed))
+                    std::this_thread::yield();
+                else if (!Pointer(FreeList_.load(std::memory_order_acquire)))
+                    throw OAException(OAException::E_NO_PAGES, "Couldnt allocate, max number of ages reached coulndt allocate more space");
+            }
+            head = FreeList_.load(std::memory_order_acquire);
+            continue;
+        }
+
+        //Next may be stale if the block was just taken, the tag makes the CAS fail then
+        GenericObject* next = Link(object).load(std::memory_order_relaxed);
+        if (FreeList_.compare_exchange_weak(head, Pack(next, Tag(head) + 1), std::memory_order_acquire, std::memory_order_acquire))
+            break;
+    }
+
+    //Stats
+    unsigned allocations = allocations_.fetch_add(1, std::memory_order_relaxed) + 1;
+    unsigned inUse = allocations - deallocations_.load(std::memory_order_relaxed);
+    unsigned most = mostObjects_.load(std::memory_order_relaxed);
+    while (inUse > most && !mostObjects_.compare_exchange_weak(most, inUse, std::memory_order_relaxed))
+        ;
+    return Pointer(head);
+}
+
+/**
+ * @brief Pushes an object back on the free list (simulates delete)
+ *
+ * @param Object point in memory to free
+ */
+void LockFreeAllocator::Free(void* Object)
+{
+    GenericObject* object = reinterpret_cast<GenericObject*>(Object);
+    Tagged head = FreeList_.load(std::memory_order_relaxed);
+    do
+    {
+        Link(object).store(Pointer(head), std::memory_order_relaxed);
+    } while (!FreeList_.compare_exchange_weak(head, Pack(object, Tag(head) + 1), std::memory_order_release, std::memory_order_relaxed));
+
+    //Stats
+    deallocations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief returns a pointer to the internal free list
+ *
+ * @return const void*
+ */
+const void* LockFreeAllocator::GetFreeList(void) const
+{
+    return Pointer(FreeList_.load(std::memory_order_acquire));
+}
+
+/**
+ * @brief returns a pointer to the internal page list
+ *
+ * @return const void*
+ */
+const void* LockFreeAllocator::GetPageList(void) const
+{
+    return PageList_.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief returns the configuration parameters
+ *
+ * @return OAConfig
+ */
+OAConfig LockFreeAllocator::GetConfig(void) const
+{
+    return configuration_;
+}
+
+/**
+ * @brief returns the statistics for the allocator, a snapshot while other threads keep going
+ *
+ * @return OAStats
+ */
+OAStats LockFreeAllocator::GetStats(void) const
+{
+    OAStats stats;
+    stats.ObjectSize_ = objectSize_;
+    stats.PageSize_ = pageSize_;
+    stats.PagesInUse_ = published_.load(std::memory_order_relaxed);
+    stats.Allocations_ = allocations_.load(std::memory_order_relaxed);
+    stats.Deallocations_ = deallocations_.load(std::memory_order_relaxed);
+    stats.ObjectsInUse_ = stats.Allocations_ - stats.Deallocations_;
+    stats.FreeObjects_ = stats.PagesInUse_ * configuration_.ObjectsPerPage_ - stats.ObjectsInUse_;
+    stats.MostObjects_ = mostObjects_.load(std::memory_order_relaxed);
+    return stats;
+}
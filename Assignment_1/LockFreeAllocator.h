@@ -0,0 +1,76 @@
+//---------------------------------------------------------------------------
+#ifndef LOCKFREEALLOCATORH
+#define LOCKFREEALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <atomic>
+#include <cstdint>
+
+// Concurrent backend with the same page layout as ObjectAllocator (no headers,
+// pads or alignment). The free list is a Treiber stack threaded through
+// GenericObject::Next whose head carries a version tag, so a block that is
+// popped and pushed back between a load and a CAS does not go unnoticed (ABA).
+//
+// Pages are only released by the destructor, so a thread reading the Next link
+// of a block another thread just took always reads mapped memory; the tag makes
+// its CAS fail. Links are read and written as std::atomic so that race is not
+// undefined behavior. Only ObjectsPerPage_ and MaxPages_ are used from the config.
+//
+// The tag takes the 16 bits above a 48 bit address on 64 bit targets (32 on 32
+// bit ones). A pop can still be fooled if, between its load of the head and its
+// CAS, other threads do exactly a multiple of 65536 pushes and pops and leave the
+// same block on top; a thread would have to stall for that many operations.
+class LockFreeAllocator
+{
+  public:
+    // Creates the allocator and its first page, objects hold the free list link so
+    // ObjectSize must be at least a pointer and keep every block aligned for one
+    // Throws an exception if ObjectSize can't hold the link (E_BAD_BOUNDARY) or the construction fails. (Memory allocation problem)
+    LockFreeAllocator(size_t ObjectSize, const OAConfig & config);
+
+    // Destroys every page (never throws)
+    ~LockFreeAllocator();
+
+    // Pops an object from the free list, creating a page when it is empty
+    // Throws an exception if the object can't be allocated. (Memory allocation problem)
+    void * Allocate(void);
+
+    // Pushes an object back on the free list
+    void Free(void * Object);
+
+    const void * GetFreeList(void) const; // returns a pointer to the internal free list
+    const void * GetPageList(void) const; // returns a pointer to the internal page list
+    OAConfig     GetConfig(void) const;   // returns the configuration parameters
+    OAStats      GetStats(void) const;    // returns the statistics for the allocator
+
+  private:
+    typedef std::uint64_t Tagged; // pointer and version of the free list head packed in one word
+
+    static Tagged          Pack(GenericObject * Object, Tagged Tag); // builds a head
+    static GenericObject * Pointer(Tagged Head);                     // object part of a head
+    static Tagged          Tag(Tagged Head);                         // version part of a head
+
+    static std::atomic<GenericObject *> & Link(GenericObject * Object); // Next of a block, as an atomic
+
+    bool CreatePage(void); // pushes a whole page on the free list, false if MaxPages_ was reached
+
+    OAConfig configuration_;
+    size_t   objectSize_;
+    size_t   pageSize_;
+
+    // Every counter gets its own cache line so threads don't fight over them
+    alignas(64) std::atomic<Tagged>          FreeList_;      // head of the free list
+    alignas(64) std::atomic<GenericObject *> PageList_;      // the beginning of the list of pages
+    std::atomic<unsigned>                    pages_;         // pages created or being created
+    std::atomic<unsigned>                    published_;     // pages whose blocks are already on the free list
+    alignas(64) std::atomic<unsigned>        allocations_;   // total requests to allocate memory
+    alignas(64) std::atomic<unsigned>        deallocations_; // total requests to free memory
+    alignas(64) std::atomic<unsigned>        mostObjects_;   // most objects in use at one time
+
+    // Make private to prevent copy construction and assignment
+    LockFreeAllocator(const LockFreeAllocator & lfa);
+    LockFreeAllocator & operator=(const LockFreeAllocator & lfa);
+};
+
+#endif
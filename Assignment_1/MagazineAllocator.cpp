@@ -0,0 +1,333 @@
+/**
+ * @file MagazineAllocator.cpp
+ * @author Diego Lopez (diego.lopez@digipen.edu)
+ * @brief Thread safe front end for ObjectAllocator with per thread magazines
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "MagazineAllocator.h"
+
+/**
+ * @brief Hands out a different id to every MagazineAllocator, so a thread never
+ *      confuses a destroyed allocator with a new one created at the same address
+ *
+ * @return unsigned long long new id
+ */
+static unsigned long long NextAllocatorId(void)
+{
+    static std::atomic<unsigned long long> next(1);
+    return next.fetch_add(1);
+}
+
+/**
+ * @brief Guards the Owner of every magazine, so an exiting thread never flushes to a destroyed allocator
+ *
+ * @return std::mutex& the lock
+ */
+static std::mutex& OwnerLock(void)
+{
+    static std::mutex lock;
+    return lock;
+}
+
+/**
+ * @brief Construct a new Magazine Allocator object
+ *
+ * @param ObjectSize Size of the object
+ * @param config configuration of the depot
+ * @param MagazineSize number of blocks each thread can cache
+ */
+MagazineAllocator::MagazineAllocator(size_t ObjectSize, const OAConfig& config, unsigned MagazineSize) :
+    depot_(ObjectSize, config), size_(MagazineSize ? MagazineSize : 1), id_(NextAllocatorId()),
+    retiredAllocations_(0), retiredDeallocations_(0)
+{
+}
+
+/**
+ * @brief Destroys the depot, blocks still in the magazines go away with its pages
+ *
+ */
+MagazineAllocator::~MagazineAllocator()
+{
+    //Threads still running keep their magazines, they just stop flushing them here
+    {
+        std::lock_guard<std::mutex> owners(OwnerLock());
+        for (size_t i = 0; i < magazines_.size(); i++)
+            magazines_[i]->Owner = nullptr;
+    }
+
+    //With new/delete the cached blocks are not on any page, give them back
+    if (depot_.GetConfig().UseCPPMemManager_)
+    {
+        for (size_t i = 0; i < magazines_.size(); i++)
+            Flush(*magazines_[i], magazines_[i]->Blocks.size());
+    }
+}
+
+/**
+ * @brief Gives every magazine of the exiting thread back to its allocator
+ *
+ */
+MagazineAllocator::ThreadCache::~ThreadCache()
+{
+    std::lock_guard<std::mutex> owners(OwnerLock());
+    for (std::unordered_map<unsigned long long, std::shared_ptr<Magazine>>::iterator it = Magazines.begin();
+         it != Magazines.end(); ++it)
+    {
+        if (it->second && it->second->Owner)
+            it->second->Owner->Retire(*it->second);
+    }
+}
+
+/**
+ * @brief Forgets the magazines of allocators that were destroyed, so a thread that goes through
+ *      many allocators only keeps the ones still alive
+ *
+ */
+void MagazineAllocator::ThreadCache::Prune(void)
+{
+    std::lock_guard<std::mutex> owners(OwnerLock());
+    std::unordered_map<unsigned long long, std::shared_ptr<Magazine>>::iterator it = Magazines.begin();
+    while (it != Magazines.end())
+    {
+        if (it->second && !it->second->Owner)
+            it = Magazines.erase(it);
+        else
+            ++it;
+    }
+}
+
+/**
+ * @brief Finds the magazine of the calling thread, the last one used is remembered
+ *      so the common case does not look anything up
+ *
+ * @return Magazine* magazine owned by the calling thread
+ */
+MagazineAllocator::Magazine* MagazineAllocator::LocalMagazine(void)
+{
+    thread_local unsigned long long lastId = 0;
+    thread_local Magazine* lastMagazine = nullptr;
+    if (lastId == id_)
+        return lastMagazine;
+
+    //Every allocator this thread used
+    thread_local ThreadCache cache;
+    std::shared_ptr<Magazine>& mag = cache.Magazines[id_];
+    if (!mag)
+    {
+        cache.Prune();
+        mag.reset(new Magazine());
+        mag->Blocks.reserve(size_ + 1);
+        mag->Cached = 0;
+        mag->Allocations = 0;
+        mag->Deallocations = 0;
+        mag->Owner = this;
+
+        std::lock_guard<std::mutex> guard(lock_);
+        magazines_.push_back(mag);
+    }
+    lastId = id_;
+    lastMagazine = mag.get();
+    return mag.get();
+}
+
+/**
+ * @brief Flushes every block of a magazine whose thread is exiting and stops counting it,
+ *      its calls are kept in the retired counts. Called with the owner lock held
+ *
+ * @param mag magazine of the exiting thread
+ */
+void MagazineAllocator::Retire(Magazine& mag)
+{
+    //A bad block (debug checks) only drops itself, keep flushing the rest
+    while (!mag.Blocks.empty())
+    {
+        try
+        {
+            Flush(mag, mag.Blocks.size());
+        }
+        catch (const OAException&)
+        {
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(lock_);
+    retiredAllocations_ += mag.Allocations.load(std::memory_order_relaxed);
+    retiredDeallocations_ += mag.Deallocations.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < magazines_.size(); i++)
+    {
+        if (magazines_[i].get() == &mag)
+        {
+            magazines_.erase(magazines_.begin() + i);
+            break;
+        }
+    }
+    mag.Owner = nullptr;
+}
+
+/**
+ * @brief Moves half a magazine of blocks from the depot with a single lock
+ *      Throws an exception if not even one block can be allocated
+ *
+ * @param mag magazine to refill
+ */
+void MagazineAllocator::Refill(Magazine& mag)
+{
+    unsigned count = (size_ + 1) / 2;
+    std::lock_guard<std::mutex> guard(lock_);
+    try
+    {
+        mag.Blocks.resize(count);
+        depot_.AllocateBatch(count, &mag.Blocks[0]);
+        return;
+    }
+    catch (const OAException&)
+    {
+        //Not enough room for the whole batch, take what is left one by one
+        mag.Blocks.clear();
+    }
+    for (unsigned i = 0; i < count; i++)
+    {
+        try
+        {
+            mag.Blocks.push_back(depot_.Allocate());
+        }
+        catch (const OAException&)
+        {
+            //Keep what we already got, only fail when there is nothing to hand out
+            if (mag.Blocks.empty())
+                throw;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Moves the oldest blocks of the magazine back to the depot with a single lock
+ *
+ * @param mag magazine to flush
+ * @param count number of blocks to move
+ */
+void MagazineAllocator::Flush(Magazine& mag, size_t count)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    OAConfig config = depot_.GetConfig();
+    if (!config.DebugOn_ && !config.QuarantineObjects_ && !config.QuarantineBytes_)
+    {
+        //Without debug checks or a quarantine nothing can fail, give them back as one batch
+        depot_.FreeBatch(mag.Blocks.empty() ? nullptr : &mag.Blocks[0], count);
+        mag.Blocks.erase(mag.Blocks.begin(), mag.Blocks.begin() + count);
+        mag.Cached.store(static_cast<unsigned>(mag.Blocks.size()), std::memory_order_relaxed);
+        return;
+    }
+
+    //One by one so a bad block only drops itself and the ones before it
+    //(a quarantine eviction throws after the block is freed, it is dropped the same way)
+    size_t done = 0;
+    try
+    {
+        for (; done < count; done++)
+            depot_.Free(mag.Blocks[done]);
+    }
+    catch (const OAException&)
+    {
+        //Drop the block that failed along with the ones already flushed
+        mag.Blocks.erase(mag.Blocks.begin(), mag.Blocks.begin() + done + 1);
+        mag.Cached.store(static_cast<unsigned>(mag.Blocks.size()), std::memory_order_relaxed);
+        throw;
+    }
+    mag.Blocks.erase(mag.Blocks.begin(), mag.Blocks.begin() + count);
+    mag.Cached.store(static_cast<unsigned>(mag.Blocks.size()), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Takes an object from the calling thread's magazine
+ *      Throws an exception if the object can't be allocated. (Memory allocation problem)
+ *
+ * @return void* pointer to the allocated memory
+ */
+void* MagazineAllocator::Allocate(void)
+{
+    Magazine* mag = LocalMagazine();
+    if (mag->Blocks.empty())
+        Refill(*mag);
+
+    void* block = mag->Blocks.back();
+    mag->Blocks.pop_back();
+
+    //Stats, only this thread writes them
+    mag->Cached.store(static_cast<unsigned>(mag->Blocks.size()), std::memory_order_relaxed);
+    mag->Allocations.store(mag->Allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return block;
+}
+
+/**
+ * @brief Puts an object on the calling thread's magazine
+ *      Throws an exception if a flushed object can't be freed. (Invalid object)
+ *
+ * @param Object point in memory to free
+ */
+void MagazineAllocator::Free(void* Object)
+{
+    Magazine* mag = LocalMagazine();
+    mag->Blocks.push_back(Object);
+
+    //Stats, only this thread writes them
+    mag->Cached.store(static_cast<unsigned>(mag->Blocks.size()), std::memory_order_relaxed);
+    mag->Deallocations.store(mag->Deallocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    //Object is cached before flushing, so it is not lost if the flush throws
+    if (mag->Blocks.size() > size_)
+        Flush(*mag, (size_ + 1) / 2);
+}
+
+/**
+ * @brief Returns every block cached by the calling thread to the depot
+ *
+ */
+void MagazineAllocator::Flush(void)
+{
+    Magazine* mag = LocalMagazine();
+    Flush(*mag, mag->Blocks.size());
+}
+
+/**
+ * @brief returns the configuration parameters of the depot
+ *
+ * @return OAConfig
+ */
+OAConfig MagazineAllocator::GetConfig(void) const
+{
+    return depot_.GetConfig();
+}
+
+/**
+ * @brief Adds up the depot and every magazine. The depot counts the blocks moved
+ *      to and from magazines, the magazines count what the client did.
+ *      MostObjects_ is the peak of blocks handed to magazines, an upper bound of the real peak.
+ *
+ * @return OAStats
+ */
+OAStats MagazineAllocator::GetStats(void) const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    OAStats stats = depot_.GetStats();
+
+    unsigned cached = 0;
+    unsigned allocations = retiredAllocations_;
+    unsigned deallocations = retiredDeallocations_;
+    for (size_t i = 0; i < magazines_.size(); i++)
+    {
+        cached += magazines_[i]->Cached.load(std::memory_order_relaxed);
+        allocations += magazines_[i]->Allocations.load(std::memory_order_relaxed);
+        deallocations += magazines_[i]->Deallocations.load(std::memory_order_relaxed);
+    }
+    stats.FreeObjects_ += cached;
+    stats.ObjectsInUse_ -= cached;
+    stats.Allocations_ = allocations;
+    stats.Deallocations_ = deallocations;
+    return stats;
+}
@@ -0,0 +1,85 @@
+//---------------------------------------------------------------------------
+#ifndef MAGAZINEALLOCATORH
+#define MAGAZINEALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// If the client doesn't specify it:
+static const unsigned DEFAULT_MAGAZINE_SIZE = 64;
+
+// Thread safe front end for ObjectAllocator. Every thread keeps a small LIFO
+// stack of blocks (a magazine) and only locks the shared ObjectAllocator (the
+// depot) to refill or flush half a magazine at a time.
+//
+// Blocks sitting in a magazine count as free objects. The debug checks of the
+// depot (boundary, multiple free, padding) run when blocks are flushed back to
+// it, not on every Free, and labels are not supported. When a thread exits its
+// magazines are flushed back to their depots.
+class MagazineAllocator
+{
+  public:
+    // Creates the depot per the specified values
+    // Throws an exception if the construction fails. (Memory allocation problem)
+    MagazineAllocator(size_t ObjectSize, const OAConfig & config, unsigned MagazineSize = DEFAULT_MAGAZINE_SIZE);
+
+    // Destroys the depot and every magazine (never throws)
+    ~MagazineAllocator();
+
+    // Takes an object from the calling thread's magazine (refills it from the depot when empty)
+    // Throws an exception if the object can't be allocated. (Memory allocation problem)
+    void * Allocate(void);
+
+    // Puts an object on the calling thread's magazine (flushes half of it to the depot when full)
+    // Throws an exception if a flushed object can't be freed, Object stays cached. (Invalid object)
+    void Free(void * Object);
+
+    // Returns every block cached by the calling thread to the depot
+    void Flush(void);
+
+    OAConfig GetConfig(void) const; // returns the configuration parameters of the depot
+    OAStats  GetStats(void) const;  // adds up the depot and every magazine
+
+  private:
+    // Per thread cache, only its owner thread writes to it
+    struct Magazine
+    {
+        std::vector<void *>   Blocks;        // cached blocks, the top is the next one handed out
+        std::atomic<unsigned> Cached;        // Blocks.size() published for GetStats
+        std::atomic<unsigned> Allocations;   // Allocate calls served by this magazine
+        std::atomic<unsigned> Deallocations; // Free calls served by this magazine
+        MagazineAllocator *   Owner;         // allocator it caches for, null once that one is destroyed
+    };
+
+    // Magazines of one thread, given back to their allocators when the thread exits
+    struct ThreadCache
+    {
+        std::unordered_map<unsigned long long, std::shared_ptr<Magazine>> Magazines; // by allocator id
+        ~ThreadCache();
+        void Prune(void); // forgets the magazines of destroyed allocators
+    };
+
+    ObjectAllocator                        depot_;     // shared allocator, guarded by lock_
+    mutable std::mutex                     lock_;      // guards depot_, magazines_ and the retired counts
+    std::vector<std::shared_ptr<Magazine>> magazines_; // one per live thread that used this allocator
+    unsigned                               size_;      // capacity of each magazine
+    unsigned long long                     id_;        // unique id, keys the thread local lookup
+    unsigned                               retiredAllocations_;   // Allocate calls of magazines of exited threads
+    unsigned                               retiredDeallocations_; // Free calls of magazines of exited threads
+
+    Magazine * LocalMagazine(void);     // magazine of the calling thread (created on first use)
+    void       Retire(Magazine & mag);  // flushes the magazine of an exiting thread and forgets it
+    void       Refill(Magazine & mag);  // moves half a magazine of blocks from the depot
+    void       Flush(Magazine & mag, size_t count); // moves count blocks back to the depot
+
+    // Make private to prevent copy construction and assignment
+    MagazineAllocator(const MagazineAllocator & ma);
+    MagazineAllocator & operator=(const MagazineAllocator & ma);
+};
+
+#endif
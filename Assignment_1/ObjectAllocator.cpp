@@ -9,7 +9,44 @@
  * 
  */
 #include "ObjectAllocator.h"
+#include "PatternCheck.h"
 #include "string.h"
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <system_error>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * @brief Index of the lowest set bit of a non zero bitmap word
+ * 
+ * @param word bitmap word, must not be 0
+ * @return unsigned position of the lowest set bit
+ */
+static unsigned LowestBit(unsigned long long word)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+    //32 bit builds only scan 32 bits at a time
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(word)))
+        return static_cast<unsigned>(index);
+    _BitScanForward(&index, static_cast<unsigned long>(word >> 32));
+    return static_cast<unsigned>(index) + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+}
 
 
 // Creates the ObjectManager per the specified values
@@ -25,11 +62,27 @@ ObjectAllocator::ObjectAllocator(size_t ObjectSize, const OAConfig& config)
 {
     //Copy configuration
     configuration_ = config;
-    //Initialize stats_
     unsigned pdBytes = configuration_.PadBytes_;
-    size_t hdBytes = configuration_.HBlockInfo_.size_;
+    HeaderBytes_ = configuration_.SideHeaders_ ? 0 : configuration_.HBlockInfo_.size_;
+    size_t hdBytes = HeaderBytes_;
+
+    //Alignment bytes so the first object and every object after it start on an aligned offset
+    unsigned alignment = configuration_.Alignment_;
+    configuration_.LeftAlignSize_ = 0;
+    configuration_.InterAlignSize_ = 0;
+    if (alignment > 1)
+    {
+        size_t left = sizeof(void*) + hdBytes + pdBytes;
+        size_t inter = ObjectSize + 2 * pdBytes + hdBytes;
+        configuration_.LeftAlignSize_ = static_cast<unsigned>((alignment - left % alignment) % alignment);
+        configuration_.InterAlignSize_ = static_cast<unsigned>((alignment - inter % alignment) % alignment);
+    }
+    FirstBlock_ = sizeof(void*) + configuration_.LeftAlignSize_ + hdBytes + pdBytes;
+    BlockStride_ = ObjectSize + 2 * pdBytes + hdBytes + configuration_.InterAlignSize_;
+
+    //Initialize stats_
     stats_.ObjectSize_ = ObjectSize;
-    stats_.PageSize_ = configuration_.ObjectsPerPage_ * ObjectSize + sizeof(char*) + 2 * configuration_.ObjectsPerPage_ * pdBytes + hdBytes * configuration_.ObjectsPerPage_;
+    stats_.PageSize_ = FirstBlock_ - hdBytes - pdBytes + configuration_.ObjectsPerPage_ * BlockStride_ - configuration_.InterAlignSize_;
     stats_.FreeObjects_ = 0;
     stats_.ObjectsInUse_ = 0;
     stats_.PagesInUse_ = 0;
@@ -38,6 +91,52 @@ ObjectAllocator::ObjectAllocator(size_t ObjectSize, const OAConfig& config)
     stats_.Deallocations_ = 0;
     PageList_ = nullptr;
     FreeList_ = nullptr;
+    Bump_ = nullptr;
+
+    //Quarantine limit, the tightest of the two and at least one block. The ring grows as blocks come in
+    QuarantineHead_ = 0;
+    QuarantineCap_ = 0;
+    if (configuration_.QuarantineObjects_ || configuration_.QuarantineBytes_)
+    {
+        QuarantineCap_ = configuration_.QuarantineObjects_ ? configuration_.QuarantineObjects_ : static_cast<size_t>(-1);
+        if (configuration_.QuarantineBytes_ && configuration_.QuarantineBytes_ / ObjectSize < QuarantineCap_)
+            QuarantineCap_ = configuration_.QuarantineBytes_ / ObjectSize;
+        if (!QuarantineCap_)
+            QuarantineCap_ = 1;
+    }
+
+    //One list per number of free blocks a page can have
+    SlabLow_ = configuration_.ObjectsPerPage_;
+    if (configuration_.SlabPages_)
+        Slabs_.resize(configuration_.ObjectsPerPage_ + 1);
+
+    //Pick where pages come from
+    provider_ = configuration_.PageProvider_;
+    if (!provider_)
+    {
+        if (configuration_.GuardPages_)
+        {
+            ownedProvider_.reset(new GuardPageProvider());
+            provider_ = ownedProvider_.get();
+        }
+        else if (configuration_.MmapPages_)
+        {
+            ownedProvider_.reset(new OSPageProvider(configuration_.HugePages_, configuration_.PopulatePages_));
+            provider_ = ownedProvider_.get();
+        }
+        else
+            provider_ = &HeapPageProvider::Instance();
+    }
+
+    //Providers that hand out whole pages (the OS) let the page size show it
+    size_t granularity = provider_->Granularity();
+    if (granularity > 1)
+        stats_.PageSize_ = (stats_.PageSize_ + granularity - 1) / granularity * granularity;
+
+    //Bytes asked for each page, over allocate when the provider doesn't give the alignment asked for
+    AllocSize_ = stats_.PageSize_;
+    if (configuration_.Alignment_ > provider_->Alignment())
+        AllocSize_ += configuration_.Alignment_ - 1;
 
     //Create First Page
     CreatePage(FreeList_, PageList_);
@@ -52,119 +151,343 @@ ObjectAllocator::ObjectAllocator(size_t ObjectSize, const OAConfig& config)
 void ObjectAllocator::CreatePage( GenericObject*& FreeList_, GenericObject*& PageList_)
 {
     //Initialize varibles
-    unsigned pdBytes = configuration_.PadBytes_;
-    size_t hdBytes = configuration_.HBlockInfo_.size_;
-    size_t ObjectSize = stats_.ObjectSize_;
-    char* Block;
+    unsigned alignment = configuration_.Alignment_;
 
     //Allocate
-    try {
-        Block = new char[stats_.PageSize_];
-    }
-    catch (const std::exception&) { throw OAException(OAException::E_NO_MEMORY, "There is no memory, error when using new"); }
+    char* Raw = AcquirePage();
 
-    //Header Initialization
-     if(hdBytes)
-     {
-         memset(Block + sizeof(GenericObject*), 0, hdBytes);
-     }
+    char* Block = Raw;
+    if (AllocSize_ > stats_.PageSize_)
+    {
+        uintptr_t address = reinterpret_cast<uintptr_t>(Raw);
+        Block = Raw + (alignment - address % alignment) % alignment;
+    }
 
-    //Pads of the first object
-    if (pdBytes)
+    //Page bookkeeping, everything that allocates is done before the page is linked anywhere so a
+    //failure only has to give the memory back
+    PageInfo info;
+    info.Page = Block;
+    info.Raw = Raw;
+    info.Live = 0;
+    info.Carved = 0;
+    info.Free = nullptr;
+    info.Available = 0;
+    info.Slot = 0;
+    try {
+        info.InUse.assign((configuration_.ObjectsPerPage_ + 63) / 64, 0);
+        if (configuration_.HBlockInfo_.type_ == OAConfig::hbExternal)
+            info.Headers.resize(configuration_.ObjectsPerPage_);
+        if (configuration_.SideHeaders_)
+            info.Side.assign(configuration_.ObjectsPerPage_ * configuration_.HBlockInfo_.size_, 0);
+        PageTable_.reserve(PageTable_.size() + 1);
+        if (configuration_.SlabPages_)
+            Slabs_[configuration_.ObjectsPerPage_].reserve(Slabs_[configuration_.ObjectsPerPage_].size() + 1);
+    }
+    catch (const std::bad_alloc&)
     {
-        memset(Block + sizeof(GenericObject*) + hdBytes, PAD_PATTERN, pdBytes);
-        memset(Block + sizeof(GenericObject*) + hdBytes + pdBytes + ObjectSize, PAD_PATTERN, pdBytes);
+        ReleasePage(Raw);
+        throw OAException(OAException::E_NO_MEMORY, "There is no memory for the bookkeeping of a new page");
     }
 
-    //First Object
-    memset(Block + sizeof(GenericObject*) + pdBytes + hdBytes + sizeof(void*) , UNALLOCATED_PATTERN, ObjectSize - sizeof(void*));
+    //Leading alignment bytes
+    memset(Block + sizeof(GenericObject*), ALIGN_PATTERN, configuration_.LeftAlignSize_);
 
     //Page List append
     GenericObject* previous = PageList_;
     PageList_ = reinterpret_cast<GenericObject*>(Block);
     PageList_->Next = previous;
 
-    //Free List append
-    previous = FreeList_;
-    FreeList_ = reinterpret_cast<GenericObject*>(reinterpret_cast<char*>((PageList_ + 1)) + pdBytes + hdBytes);
-    FreeList_->Next = previous;
-    char* other = Block + sizeof(char*);
+    //Page Table slot (kept sorted so FindPage can binary search)
+    std::vector<PageInfo>::iterator it = std::lower_bound(PageTable_.begin(), PageTable_.end(), Block,
+        [](const PageInfo& Info, const char* Page) { return Info.Page < Page; });
 
-    //Fills the free List
-    for (unsigned int i = 1; i < configuration_.ObjectsPerPage_; i++)
+    //Lazy pages leave their blocks alone until Carve hands them out
+    if (configuration_.LazyPages_ && !configuration_.SlabPages_)
     {
-        //Updates Free List
-        GenericObject* prev = FreeList_;
-        FreeList_ = reinterpret_cast<GenericObject*>(other + pdBytes + hdBytes + i * (ObjectSize + 2 * pdBytes + hdBytes));
-        FreeList_->Next = prev;
-        GenericObject* temp = FreeList_;
-        //Updates the Debug
-        memset(reinterpret_cast<char*>(temp)+sizeof(void*), UNALLOCATED_PATTERN, ObjectSize-sizeof(void*));   
-        
-        //Headers
-        if(hdBytes && configuration_.DebugOn_)
-            memset(other + i * (ObjectSize + 2 * pdBytes + hdBytes), 0, hdBytes);
-
-        //Pad Pattern
-        if (pdBytes && configuration_.DebugOn_)
+        if (!Bump_)
+            Bump_ = Block;
+    }
+    else
+    {
+        //Slab pages keep their own free list, the first object of the page ends up at the head
+        GenericObject*& list = configuration_.SlabPages_ ? info.Free : FreeList_;
+        for (unsigned int i = 0; i < configuration_.ObjectsPerPage_; i++)
         {
-            memset(other + i * (ObjectSize + 2 * pdBytes + hdBytes) + hdBytes, PAD_PATTERN, pdBytes);
-            memset(other + i * (ObjectSize + 2 * pdBytes + hdBytes) + hdBytes + ObjectSize + pdBytes, PAD_PATTERN, pdBytes);
-        }    
+            unsigned index = configuration_.SlabPages_ ? configuration_.ObjectsPerPage_ - 1 - i : i;
+            char* object = Block + FirstBlock_ + index * BlockStride_;
+            InitBlock(object, index, true);
+
+            //Updates Free List
+            GenericObject* prev = list;
+            list = reinterpret_cast<GenericObject*>(object);
+            list->Next = prev;
+        }
+        info.Carved = configuration_.ObjectsPerPage_;
     }
 
+    //On the empty list
+    if (configuration_.SlabPages_)
+    {
+        info.Available = configuration_.ObjectsPerPage_;
+        info.Slot = static_cast<unsigned>(Slabs_[info.Available].size());
+        Slabs_[info.Available].push_back(Block);
+        if (info.Available < SlabLow_)
+            SlabLow_ = info.Available;
+    }
+
+    PageTable_.insert(it, std::move(info));
+
     //Update stats
     stats_.FreeObjects_ += configuration_.ObjectsPerPage_;
     stats_.PagesInUse_++;
 }
 
+/**
+ * @brief Gets the memory for one page from the page provider
+ *      Throws an exception if there is no memory. (Memory allocation problem)
+ * 
+ * @return char* AllocSize_ bytes for the page
+ */
+char* ObjectAllocator::AcquirePage(void)
+{
+    char* Raw = provider_->AllocatePage(AllocSize_);
+    if (!Raw)
+        throw OAException(OAException::E_NO_MEMORY, "There is no memory, the page provider failed");
+    return Raw;
+}
 
 /**
- * @brief Destroys the ObjectManager (never throws)
+ * @brief Gives the memory of a page back to the page provider
  * 
+ * @param Raw what AcquirePage returned
  */
-ObjectAllocator::~ObjectAllocator()
+void ObjectAllocator::ReleasePage(char* Raw)
+{
+    provider_->ReleasePage(Raw, AllocSize_);
+}
+
+/**
+ * @brief Writes the inter alignment bytes, header and pads around a block
+ * 
+ * @param Object start of the block
+ * @param Index position of the block in its page
+ * @param Unallocated true to also fill the block with UNALLOCATED_PATTERN
+ */
+void ObjectAllocator::InitBlock(char* Object, unsigned Index, bool Unallocated)
 {
     unsigned pdBytes = configuration_.PadBytes_;
-    size_t hdBytes = configuration_.HBlockInfo_.size_;
+    size_t hdBytes = HeaderBytes_;
+    size_t ObjectSize = stats_.ObjectSize_;
 
-    //Check if headers need to be deallocated
-    if (configuration_.HBlockInfo_.type_ == OAConfig::hbExternal)
-    {      
-        //Check through all the lists
-        while (PageList_)
-        {
-            char* pList = reinterpret_cast<char*>(PageList_) + sizeof(void*);
-            unsigned OPP = configuration_.ObjectsPerPage_;
-            //Run through every header
-            for (unsigned i = 0; i < OPP; i++)
-            {
-                char* header = pList + i * (stats_.ObjectSize_ + 2 * pdBytes + hdBytes);
-                MemBlockInfo** headerPtr = reinterpret_cast<MemBlockInfo**>(header);
-                if (*headerPtr)
-                {
-                    //Deletes the label inside the header
-                    delete[](*headerPtr)->label;
-                    (*headerPtr)->label = nullptr;
-                    //Delete the header
-                    delete *headerPtr;
-                    (*headerPtr) = nullptr;
-                }
-            }
-            GenericObject* temp = PageList_;
-            PageList_ = PageList_->Next;
-            delete[] temp;//Delete previous List
-        }
+    //Inter alignment bytes between this object and the previous one (every block of a page comes through
+    //here, so the calls for parts the layout doesn't have are skipped)
+    if (Index > 0 && configuration_.InterAlignSize_)
+        memset(Object - pdBytes - hdBytes - configuration_.InterAlignSize_, ALIGN_PATTERN, configuration_.InterAlignSize_);
+
+    //Headers
+    if (hdBytes)
+        memset(Object - pdBytes - hdBytes, 0, hdBytes);
+
+    //Pad Pattern
+    if (pdBytes)
+    {
+        memset(Object - pdBytes, PAD_PATTERN, pdBytes);
+        memset(Object + ObjectSize, PAD_PATTERN, pdBytes);
     }
-    else
+
+    //Updates the Debug
+    if (Unallocated)
+        memset(Object + sizeof(void*), UNALLOCATED_PATTERN, ObjectSize - sizeof(void*));
+}
+
+/**
+ * @brief Hands out the next never used block of a page being carved (LazyPages_)
+ * 
+ * @param page receives the page of the block
+ * @return GenericObject* the block, its page bookkeeping is not updated yet
+ */
+GenericObject* ObjectAllocator::Carve(PageInfo*& page)
+{
+    //A batch can create several pages at once, move on to the next one not fully carved
+    if (!Bump_)
     {
-        while (PageList_)
+        for (size_t i = 0; i < PageTable_.size() && !Bump_; i++)
         {
-            GenericObject* temp = PageList_;
-            PageList_ = PageList_->Next;
-            delete[] temp;
+            if (PageTable_[i].Carved < configuration_.ObjectsPerPage_)
+                Bump_ = PageTable_[i].Page;
         }
     }
+
+    page = FindPage(Bump_);
+    unsigned index = page->Carved++;
+    char* object = Bump_ + FirstBlock_ + index * BlockStride_;
+    InitBlock(object, index, false);
+
+    //Last block, the next one comes from a new page
+    if (page->Carved == configuration_.ObjectsPerPage_)
+        Bump_ = nullptr;
+    return reinterpret_cast<GenericObject*>(object);
+}
+
+/**
+ * @brief Finds the page that contains the given address with a binary search on the page table
+ * 
+ * @param Object address to look for
+ * @return PageInfo* bookkeeping of the page holding Object, nullptr if it is not on any page
+ */
+ObjectAllocator::PageInfo* ObjectAllocator::FindPage(const void* Object)
+{
+    return const_cast<PageInfo*>(static_cast<const ObjectAllocator*>(this)->FindPage(Object));
+}
+
+/**
+ * @brief Finds the page that contains the given address (const version)
+ * 
+ * @param Object address to look for
+ * @return const PageInfo* bookkeeping of the page holding Object, nullptr if it is not on any page
+ */
+const ObjectAllocator::PageInfo* ObjectAllocator::FindPage(const void* Object) const
+{
+    const char* address = reinterpret_cast<const char*>(Object);
+
+    //First page that starts after the address, the one before it is the candidate
+    size_t low = 0;
+    size_t high = PageTable_.size();
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (PageTable_[middle].Page <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0)
+        return nullptr;
+
+    //Check it is inside the candidate page
+    const PageInfo& info = PageTable_[low - 1];
+    if (address >= info.Page + stats_.PageSize_)
+        return nullptr;
+    return &info;
+}
+
+/**
+ * @brief Finds the empty page holding an address with a binary search on the empty pages only
+ * 
+ * @param EmptyPages start of every empty page, sorted by address
+ * @param Object address to look for
+ * @return const char* start of the empty page holding Object, null if it is not on one
+ */
+const char* ObjectAllocator::EmptyPageOf(const std::vector<const char*>& EmptyPages, const void* Object) const
+{
+    const char* address = reinterpret_cast<const char*>(Object);
+    std::vector<const char*>::const_iterator it = std::upper_bound(EmptyPages.begin(), EmptyPages.end(), address);
+    if (it == EmptyPages.begin() || address >= *(it - 1) + stats_.PageSize_)
+        return nullptr;
+    return *(it - 1);
+}
+
+/**
+ * @brief Computes which block of the page the given object is
+ * 
+ * @param Page page holding the object
+ * @param Object start of the object
+ * @return unsigned index of the block inside the page
+ */
+unsigned ObjectAllocator::BlockIndex(const PageInfo& Page, const void* Object) const
+{
+    return static_cast<unsigned>((reinterpret_cast<const char*>(Object) - Page.Page - FirstBlock_) / BlockStride_);
+}
+
+/**
+ * @brief Destroys the ObjectManager (never throws)
+ * 
+ */
+ObjectAllocator::~ObjectAllocator()
+{
+    //External headers live in the page table, only the pages and the labels need to go
+    for (size_t p = 0; p < PageTable_.size(); p++)
+        ReleasePage(PageTable_[p].Raw);
+    PageTable_.clear();
+    PageList_ = nullptr;
+}
+
+/**
+ * @brief Frees every label stored
+ * 
+ */
+OALabels::~OALabels()
+{
+    for (std::unordered_set<const char*, Hash, Equal>::iterator it = labels_.begin(); it != labels_.end(); ++it)
+        delete[] *it;
+}
+
+/**
+ * @brief Hashes a label by its contents (FNV-1a)
+ * 
+ * @param label NUL-terminated string
+ * @return size_t hash of the string
+ */
+size_t OALabels::Hash::operator()(const char* label) const
+{
+    size_t hash = static_cast<size_t>(14695981039346656037ULL);
+    for (; *label; label++)
+    {
+        hash ^= static_cast<unsigned char>(*label);
+        hash *= static_cast<size_t>(1099511628211ULL);
+    }
+    return hash;
+}
+
+/**
+ * @brief Compares two labels by their contents
+ * 
+ * @param lhs NUL-terminated string
+ * @param rhs NUL-terminated string
+ * @return true if both hold the same string
+ */
+bool OALabels::Equal::operator()(const char* lhs, const char* rhs) const
+{
+    return strcmp(lhs, rhs) == 0;
+}
+
+/**
+ * @brief Finds the stored copy of a label, the first time a label is seen it is copied once and kept until the end
+ *      Throws an exception if the copy can't be allocated. (Memory allocation problem)
+ * 
+ * @param label NUL-terminated string
+ * @return char* copy shared by every block with the same label
+ */
+char* OALabels::Intern(const char* label)
+{
+    std::unordered_set<const char*, Hash, Equal>::iterator it = labels_.find(label);
+    if (it != labels_.end())
+        return const_cast<char*>(*it);
+
+    char* copy = new (std::nothrow) char[strlen(label) + 1];
+    if (!copy)
+        throw OAException(OAException::E_NO_MEMORY, "There is no memory, the label couldnt be copied");
+    strcpy(copy, label);
+    try
+    {
+        labels_.insert(copy);
+    }
+    catch (const std::bad_alloc&)
+    {
+        delete[] copy;
+        throw OAException(OAException::E_NO_MEMORY, "There is no memory, the label couldnt be copied");
+    }
+    return copy;
+}
+
+/**
+ * @brief Number of distinct labels stored
+ * 
+ * @return size_t
+ */
+size_t OALabels::Count(void) const
+{
+    return labels_.size();
 }
 // 
 // Throws an exception if the object can't be allocated. (Memory allocation problem)
@@ -177,8 +500,6 @@ ObjectAllocator::~ObjectAllocator()
  */
 void* ObjectAllocator::Allocate(const char* label)
 {  
-    //For later ifs
-    bool State = configuration_.DebugOn_;
     //Check if we are going to use the custom allocator
     if (configuration_.UseCPPMemManager_)
     {
@@ -196,79 +517,150 @@ void* ObjectAllocator::Allocate(const char* label)
     else
     {
         //CUSTOM ALLOCATION
-        unsigned pdBytes = configuration_.PadBytes_;
-        size_t hdBytes = configuration_.HBlockInfo_.size_;
+        //The label is interned before anything changes, a failed copy leaves the allocator as it was
+        if (label && configuration_.HBlockInfo_.type_ == OAConfig::hbExternal && !configuration_.StaticLabels_)
+            label = Labels_.Intern(label);
+
         //Check there is space in the current page
         if (stats_.FreeObjects_ == 0)
         {
             //Check if there are pages left
-            if (stats_.PagesInUse_ != configuration_.MaxPages_)
+            if (!configuration_.MaxPages_ || stats_.PagesInUse_ < configuration_.MaxPages_)
             {
                 CreatePage(FreeList_, PageList_);
             }
+            else if (stats_.Quarantined_)
+            {
+                //Out of pages, reuse the block that waited the longest
+                if (!Evict())
+                    throw OAException(OAException::E_CORRUPTED_BLOCK, "Corrupted, a freed block was written after it was freed");
+            }
             else
             {
                 throw OAException(OAException::E_NO_PAGES, "Couldnt allocate, max number of ages reached coulndt allocate more space");
             }
         }
-        if (stats_.FreeObjects_ != 0)
-        {
-            //Update Free List
-            GenericObject* temp = FreeList_;
+
+        //Update Free List, lazy pages carve a new block once it runs out
+        PageInfo* page = nullptr;
+        GenericObject* temp = FreeList_;
+        if (configuration_.SlabPages_)
+            temp = SlabPop(page);
+        else if (temp)
             FreeList_ = FreeList_->Next;
+        else
+            temp = Carve(page);
+
+        //Stats
+        stats_.FreeObjects_--;
+        stats_.ObjectsInUse_++;
+        if (stats_.ObjectsInUse_ > stats_.MostObjects_)
+        {
+            stats_.MostObjects_ = stats_.ObjectsInUse_;
+        }
+        stats_.Allocations_++;
+
+        MarkAllocated(page, temp, stats_.Allocations_, label);
+        return reinterpret_cast<void*>(temp);
+    }
+}
+
+/**
+ * @brief Takes n objects from the free list at once, the stats are updated once for the whole batch
+ *      Throws an exception if the objects can't be allocated, nothing is allocated then. (Memory allocation problem)
+ * 
+ * @param n number of objects
+ * @param out array that receives the n objects
+ */
+void ObjectAllocator::AllocateBatch(size_t n, void** out)
+{
+    if (!n)
+        return;
 
-            //Stats
-            if(State)
-                memset(temp, 0xBB, stats_.ObjectSize_);
-            stats_.FreeObjects_--;
-            stats_.ObjectsInUse_++;
-            if (stats_.ObjectsInUse_ > stats_.MostObjects_)
+    if (configuration_.UseCPPMemManager_)
+    {
+        //TRADITIONAL ALLOCATION
+        for (size_t i = 0; i < n; i++)
+            out[i] = new char[stats_.ObjectSize_];
+    }
+    else
+    {
+        //Make sure the whole batch fits before creating a page or touching the free list
+        if (configuration_.MaxPages_ && stats_.FreeObjects_ + stats_.Quarantined_ +
+            static_cast<size_t>(configuration_.MaxPages_ - stats_.PagesInUse_) * configuration_.ObjectsPerPage_ < n)
+            throw OAException(OAException::E_NO_PAGES, "Couldnt allocate, max number of ages reached coulndt allocate more space");
+        while (stats_.FreeObjects_ < n)
+        {
+            if (!configuration_.MaxPages_ || stats_.PagesInUse_ < configuration_.MaxPages_)
+                CreatePage(FreeList_, PageList_);
+            else if (stats_.FreeObjects_ + stats_.Quarantined_ >= n)
             {
-                stats_.MostObjects_ = stats_.ObjectsInUse_;
+                if (!Evict())
+                    throw OAException(OAException::E_CORRUPTED_BLOCK, "Corrupted, a freed block was written after it was freed");
             }
-            stats_.Allocations_++;
+            else
+                throw OAException(OAException::E_NO_PAGES, "Couldnt allocate, max number of ages reached coulndt allocate more space");
+        }
 
-            //Header
-            unsigned int* ptr;
-            short* counter;
-            char* header = reinterpret_cast<char*>(temp) - pdBytes - hdBytes;
-            if (configuration_.HBlockInfo_.type_ != OAConfig::hbNone)
+        //Only debug checks and headers that live outside the block need anything done per object
+        bool mark = configuration_.DebugOn_ || configuration_.SideHeaders_ ||
+                    configuration_.HBlockInfo_.type_ == OAConfig::hbExternal;
+        PageInfo* page = nullptr;
+        size_t i = 0;
+        if (configuration_.SlabPages_)
+        {
+            //Slab pages give up as much of their own list as the batch needs, fullest page first
+            while (i < n)
             {
-                if (configuration_.HBlockInfo_.type_ == OAConfig::hbBasic && State)
+                while (Slabs_[SlabLow_].empty())
+                    SlabLow_++;
+                page = FindPage(Slabs_[SlabLow_].back());
+                size_t take = n - i < page->Available ? n - i : page->Available;
+                GenericObject* block = page->Free;
+                for (size_t end = i + take; i < end; i++)
                 {
-                    ptr = reinterpret_cast<unsigned int*>(header);
-                    *ptr = stats_.Allocations_;
-                    *(header + 4) = 1;
+                    out[i] = block;
+                    block = block->Next;
                 }
-                else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExtended && State)
-                {
-                    counter = reinterpret_cast<short*>(header + 1);
-                    (*counter)++;
-                    ptr = reinterpret_cast<unsigned int*>(header + 3);
-                    *ptr = stats_.Allocations_;
-                    *(header + 7) = 1;
-                }
-                else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExternal)
+                page->Free = block;
+                SlabMove(*page, page->Available - static_cast<unsigned>(take));
+            }
+        }
+        else
+        {
+            //Split the first n blocks off the free list, only lazy pages run out of it before FreeObjects_ does
+            GenericObject* block = FreeList_;
+            for (; i < n; i++)
+            {
+                if (!block)
                 {
-                    MemBlockInfo** headerPtr = reinterpret_cast<MemBlockInfo**>(header);
-                    *(headerPtr) = new MemBlockInfo();//Alllocate memory for header
-                    (*headerPtr)->in_use = 1;
-                    (*headerPtr)->alloc_num = stats_.Allocations_;
-                    if (label)
-                    {
-                        (*headerPtr)->label = new char[strlen(label) + 1];//Allocate memory for the label
-                        strcpy((*headerPtr)->label, label);//Copy the label
-                    }
-                    else
-                    {
-                        (*headerPtr)->label = nullptr;
-                    }
+                    block = Carve(page);
+                    block->Next = nullptr;
                 }
+                out[i] = block;
+                block = block->Next;
             }
-            return reinterpret_cast<void*>(temp);
+            FreeList_ = block;
+        }
+        stats_.FreeObjects_ -= static_cast<unsigned>(n);
+
+        //The per object work, with the page of the previous block as the guess for the next one
+        page = nullptr;
+        for (i = 0; i < n && mark; i++)
+        {
+            if (!OnPage(page, out[i]))
+                page = FindPage(out[i]);
+            MarkAllocated(page, out[i], stats_.Allocations_ + static_cast<unsigned>(i) + 1, nullptr);
         }
     }
-    return nullptr;
+
+    //Stats
+    stats_.ObjectsInUse_ += static_cast<unsigned>(n);
+    if (stats_.ObjectsInUse_ > stats_.MostObjects_)
+    {
+        stats_.MostObjects_ = stats_.ObjectsInUse_;
+    }
+    stats_.Allocations_ += static_cast<unsigned>(n);
 }
 
 
@@ -280,8 +672,6 @@ void* ObjectAllocator::Allocate(const char* label)
  */
 void ObjectAllocator::Free(void* Object)
 {
-    bool State = configuration_.DebugOn_;
-
     //Check if we are going to use custom Allocator
     if (configuration_.UseCPPMemManager_)
     {
@@ -295,183 +685,516 @@ void ObjectAllocator::Free(void* Object)
     else
     {
         //CUSTOM DEALLOCATION
-        unsigned pdBytes = configuration_.PadBytes_;
-        size_t hdBytes = configuration_.HBlockInfo_.size_;
-
-        GenericObject* other = PageList_;
-        bool found = false;
-
-        if (State)
-        {
-            //look thorough the pages for boundary check
-            while (other)
-            {
-                GenericObject* temp = other;
-                //see if in the boundaries of the current page
-                if (Object > temp && Object < reinterpret_cast<char*>(temp) + stats_.PageSize_)
-                {
-                    char* PageTemp = reinterpret_cast<char*>(other);
-                    size_t firstOBJ = sizeof(void*) + hdBytes + pdBytes;
-                    size_t offset = (stats_.ObjectSize_ + 2 * pdBytes + hdBytes);
-                    auto position = reinterpret_cast<char*>(Object) - PageTemp - firstOBJ;
-                    //check with modulus
-                    if (position % offset == 0)
-                    {
-                        found = true;
-                        break;
-                    }
-                    else
-                    {
-                        found = false;
-                        break;
-                    }
-                }
-                other = other->Next;
-                if (found)
-                    break;
-            }
-            if (!found)
-                throw OAException(OAException::E_BAD_BOUNDARY, "Bad boundary for Free, the adress given was not usable");
-
-            if (hdBytes)
-            {
-                //Look in Header
-                if (configuration_.HBlockInfo_.type_ == OAConfig::hbBasic || configuration_.HBlockInfo_.type_ == OAConfig::hbExtended)
-                {
-                    //Look in header
-                    if (*(reinterpret_cast<char*>(Object) - pdBytes - 1) == 0)
-                        throw OAException(OAException::E_MULTIPLE_FREE, "Multiple Free, you tried to free object twice");
-                }
-                else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExternal)
-                {
-                    MemBlockInfo** save = reinterpret_cast<MemBlockInfo**>(reinterpret_cast<char*>(Object) - pdBytes - hdBytes);
-                    if (*save)
-                    {
-                        if (!(*save)->in_use)
-                            throw OAException(OAException::E_MULTIPLE_FREE, "Multiple Free, you tried to free object twice");
-                    }
-                }
-            }
-            else
-            {
-                //Check double Free
-                GenericObject* temp = FreeList_;
-                for (unsigned int i = 0; i < stats_.FreeObjects_; i++)
-                {
-                    if (Object == temp)
-                        throw OAException(OAException::E_MULTIPLE_FREE, "Multiple Free, you tried to free object twice");
-                    temp = temp->Next;
-                }
-            }
-
-            //Check for Padding corruption
-            unsigned char* ptr1 = reinterpret_cast<unsigned char*>(Object) - pdBytes;
-            unsigned char* ptr2 = ptr1 + stats_.ObjectSize_ + pdBytes;
-            for (size_t i = 0; i < pdBytes; i++)
-            {
-                //Left Pad
-                if (ptr1[i] != PAD_PATTERN)
-                {
-                    throw OAException(OAException::E_CORRUPTED_BLOCK, "Corrupted");
-                }
-                //Right Pad
-                if (ptr2[i] != PAD_PATTERN)
-                {
-                    throw OAException(OAException::E_CORRUPTED_BLOCK, "Corrupted");
-                }
-            }
-
-            memset(reinterpret_cast<char*>(Object), FREED_PATTERN, stats_.ObjectSize_);
-        }
-        GenericObject* ptr = reinterpret_cast<GenericObject*>(Object);
-        ptr->Next = FreeList_;
-        FreeList_ = ptr;
+        //Find the page with the page table instead of walking the page list, only when something of it is needed
+        PageInfo* page = nullptr;
+        if (configuration_.DebugOn_ || configuration_.SlabPages_ || configuration_.SideHeaders_)
+            page = FindPage(Object);
+        if (configuration_.DebugOn_)
+            CheckFree(page, Object);
+        MarkFreed(page, Object);
 
         //Stats
-        stats_.FreeObjects_++;
         stats_.ObjectsInUse_--;
         stats_.Deallocations_++;
 
-        //Header
-        char* header = reinterpret_cast<char*>(Object) - pdBytes - hdBytes;
-        if (configuration_.HBlockInfo_.type_ != OAConfig::hbNone)
+        GenericObject* ptr = reinterpret_cast<GenericObject*>(Object);
+        if (QuarantineCap_)
         {
-            if (configuration_.HBlockInfo_.type_ == OAConfig::hbBasic && State)
-            {
-
-                *reinterpret_cast<unsigned int*>(header) = 0;
-                *(header + 4) = 0;
-            }
-            else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExtended && State)
-            {
-                *reinterpret_cast<unsigned int*>(header + 3) = 0;
-                *(header + 7) = 0;
-            }
-            else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExternal)
-            {
-                MemBlockInfo** headerPtr = reinterpret_cast<MemBlockInfo**>(header);
-                if ((*headerPtr))
-                {
-                    //Delete label
-                    if ((*headerPtr)->label)
-                    {
-                        delete[](*headerPtr)->label;
-                        (*headerPtr)->label = nullptr;
-                    }
-                    //Delete header
-                    delete* headerPtr;
-                    *headerPtr = nullptr;
-                    headerPtr = nullptr;
-                }
-            }
-
+            Quarantine(ptr);
+            return;
         }
+        PushFree(page, ptr);
     }
 }
 
-
 /**
- * @brief Calls the callback fn for each block still in use
+ * @brief Puts a freed block on the free list, or on the list of its page with SlabPages_
  * 
- * @param fn Dump callback function
- * @return unsigned counter of dumps
+ * @param page page holding the block
+ * @param Object block to put back
  */
-unsigned ObjectAllocator::DumpMemoryInUse(DUMPCALLBACK fn) const
+void ObjectAllocator::PushFree(PageInfo* page, GenericObject* Object)
 {
-    unsigned count = 0;
-    GenericObject* temp = PageList_;
-    size_t pdBytes = configuration_.PadBytes_;
-    size_t hdBytes = configuration_.HBlockInfo_.size_;
-    while(temp)
+    if (configuration_.SlabPages_)
     {
-        char* itr = reinterpret_cast<char*>(temp);
-        for (unsigned int i = 0; i < configuration_.ObjectsPerPage_; i++)
+        Object->Next = page->Free;
+        page->Free = Object;
+        SlabMove(*page, page->Available + 1);
+    }
+    else
+    {
+        Object->Next = FreeList_;
+        FreeList_ = Object;
+    }
+    stats_.FreeObjects_++;
+}
+
+/**
+ * @brief Takes a free block from the fullest page that has one, so live objects pack into few pages
+ *      There has to be a free block (FreeObjects_ > 0)
+ * 
+ * @param page receives the page of the block
+ * @return GenericObject* the block
+ */
+GenericObject* ObjectAllocator::SlabPop(PageInfo*& page)
+{
+    //The fullest partial page, the empty list is the last one looked at
+    while (Slabs_[SlabLow_].empty())
+        SlabLow_++;
+
+    page = FindPage(Slabs_[SlabLow_].back());
+    GenericObject* block = page->Free;
+    page->Free = block->Next;
+    SlabMove(*page, page->Available - 1);
+    return block;
+}
+
+/**
+ * @brief Moves a page to the slab list of pages with the given number of free blocks
+ * 
+ * @param page page to move
+ * @param Available free blocks it has now
+ */
+void ObjectAllocator::SlabMove(PageInfo& page, unsigned Available)
+{
+    //Unlink it, the last page of the list takes its slot
+    std::vector<char*>& from = Slabs_[page.Available];
+    char* last = from.back();
+    if (last != page.Page)
+    {
+        from[page.Slot] = last;
+        FindPage(last)->Slot = page.Slot;
+    }
+    from.pop_back();
+
+    page.Available = Available;
+    page.Slot = static_cast<unsigned>(Slabs_[Available].size());
+    Slabs_[Available].push_back(page.Page);
+    if (Available && Available < SlabLow_)
+        SlabLow_ = Available;
+}
+
+/**
+ * @brief Holds a freed block back from reuse, when the quarantine is full the oldest one goes to the free list
+ *      Throws an exception if the oldest one was written while it waited. (Use after free)
+ * 
+ * @param Object block that was just freed
+ */
+void ObjectAllocator::Quarantine(GenericObject* Object)
+{
+    //The whole block holds the pattern while it waits, not even the free list link is written
+    memset(Object, FREED_PATTERN, stats_.ObjectSize_);
+
+    bool intact = true;
+    if (stats_.Quarantined_ == QuarantineCap_)
+        intact = Evict();
+    else if (stats_.Quarantined_ == Quarantine_.size())
+        GrowQuarantine();
+    Quarantine_[(QuarantineHead_ + stats_.Quarantined_) % Quarantine_.size()] = Object;
+    stats_.Quarantined_++;
+
+    if (!intact)
+        throw OAException(OAException::E_CORRUPTED_BLOCK, "Corrupted, a freed block was written after it was freed");
+}
+
+/**
+ * @brief Doubles the slots of the quarantine ring (up to QuarantineCap_), the oldest block ends up in slot 0
+ * 
+ */
+void ObjectAllocator::GrowQuarantine(void)
+{
+    size_t slots = Quarantine_.empty() ? 16 : Quarantine_.size() * 2;
+    if (slots > QuarantineCap_)
+        slots = QuarantineCap_;
+
+    std::vector<GenericObject*> ring(slots);
+    for (size_t i = 0; i < stats_.Quarantined_; i++)
+        ring[i] = Quarantine_[(QuarantineHead_ + i) % Quarantine_.size()];
+    Quarantine_.swap(ring);
+    QuarantineHead_ = 0;
+}
+
+/**
+ * @brief Moves the block that has been in the quarantine the longest to the free list
+ * 
+ * @return true if it still held FREED_PATTERN, false if something wrote to it after it was freed
+ */
+bool ObjectAllocator::Evict(void)
+{
+    GenericObject* oldest = Quarantine_[QuarantineHead_];
+    QuarantineHead_ = (QuarantineHead_ + 1) % Quarantine_.size();
+    stats_.Quarantined_--;
+
+    bool intact = PatternMatches(oldest, stats_.ObjectSize_, FREED_PATTERN);
+    PushFree(configuration_.SlabPages_ ? FindPage(oldest) : nullptr, oldest);
+    return intact;
+}
+
+/**
+ * @brief Returns n objects to the free list at once, they are chained first and pushed as one sub list
+ *      Throws an exception if one of the objects can't be freed. (Invalid object)
+ *      The objects before it are still freed.
+ * 
+ * @param ptrs objects to free
+ * @param n number of objects
+ */
+void ObjectAllocator::FreeBatch(void** ptrs, size_t n)
+{
+    //Every block has to go through the quarantine in order, or back to its own page
+    if ((QuarantineCap_ || configuration_.SlabPages_) && !configuration_.UseCPPMemManager_)
+    {
+        for (size_t i = 0; i < n; i++)
+            Free(ptrs[i]);
+        return;
+    }
+
+    if (configuration_.UseCPPMemManager_)
+    {
+        //TRADITIONAL DEALLOCATION
+        for (size_t i = 0; i < n; i++)
+            delete [] reinterpret_cast<char*>(ptrs[i]);
+        stats_.FreeObjects_ += static_cast<unsigned>(n);
+        stats_.ObjectsInUse_ -= static_cast<unsigned>(n);
+        stats_.Deallocations_ += static_cast<unsigned>(n);
+        return;
+    }
+
+    GenericObject* head = FreeList_;
+    PageInfo* page = nullptr;
+    size_t done = 0;
+    try
+    {
+        for (; done < n; done++)
+        {
+            if (!OnPage(page, ptrs[done]))
+                page = FindPage(ptrs[done]);
+            if (configuration_.DebugOn_)
+                CheckFree(page, ptrs[done]);
+            MarkFreed(page, ptrs[done]);
+
+            GenericObject* ptr = reinterpret_cast<GenericObject*>(ptrs[done]);
+            ptr->Next = head;
+            head = ptr;
+        }
+    }
+    catch (const OAException&)
+    {
+        //Keep the ones that made it
+        FreeList_ = head;
+        stats_.FreeObjects_ += static_cast<unsigned>(done);
+        stats_.ObjectsInUse_ -= static_cast<unsigned>(done);
+        stats_.Deallocations_ += static_cast<unsigned>(done);
+        throw;
+    }
+
+    //Stats
+    FreeList_ = head;
+    stats_.FreeObjects_ += static_cast<unsigned>(n);
+    stats_.ObjectsInUse_ -= static_cast<unsigned>(n);
+    stats_.Deallocations_ += static_cast<unsigned>(n);
+}
+
+/**
+ * @brief Checks an object before freeing it (boundary, multiple free and padding)
+ *      Throws an exception if the the object can't be freed. (Invalid object)
+ * 
+ * @param page page holding the object, null if it is on none
+ * @param Object point in memory to free
+ */
+void ObjectAllocator::CheckFree(PageInfo* page, void* Object) const
+{
+    size_t hdBytes = configuration_.HBlockInfo_.size_;
+
+    if (!page)
+        throw OAException(OAException::E_BAD_BOUNDARY, "Bad boundary for Free, the adress given was not usable");
+
+    //check with modulus
+    size_t position = reinterpret_cast<char*>(Object) - page->Page;
+    if (position < FirstBlock_ || (position - FirstBlock_) % BlockStride_ != 0)
+        throw OAException(OAException::E_BAD_BOUNDARY, "Bad boundary for Free, the adress given was not usable");
+
+    //Pages rounded up to OS pages have room after the last block that lines up with the stride
+    if (BlockIndex(*page, Object) >= configuration_.ObjectsPerPage_)
+        throw OAException(OAException::E_BAD_BOUNDARY, "Bad boundary for Free, the adress given was not usable");
+
+    //A lazy page block that was never handed out
+    if (BlockIndex(*page, Object) >= page->Carved)
+        throw OAException(OAException::E_MULTIPLE_FREE, "Multiple Free, you tried to free object twice");
+
+    if (hdBytes)
+    {
+        //Look in Header
+        if (configuration_.HBlockInfo_.type_ == OAConfig::hbBasic || configuration_.HBlockInfo_.type_ == OAConfig::hbExtended)
+        {
+            //Look in header
+            if (*(HeaderOf(page, Object) + hdBytes - 1) == 0)
+                throw OAException(OAException::E_MULTIPLE_FREE, "Multiple Free, you tried to free object twice");
+        }
+        else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExternal)
         {
-            //Take object
-            GenericObject* object = reinterpret_cast<GenericObject*>(itr + sizeof(void*) + hdBytes + pdBytes + i * (stats_.ObjectSize_ + 2 * pdBytes + hdBytes));
+            //Free deletes the header, so a block without one was already freed
+            MemBlockInfo** save = reinterpret_cast<MemBlockInfo**>(HeaderOf(page, Object));
+            if (!*save || !(*save)->in_use)
+                throw OAException(OAException::E_MULTIPLE_FREE, "Multiple Free, you tried to free object twice");
+        }
+    }
+    else
+    {
+        //Check double Free with the in use bit of the block
+        unsigned index = BlockIndex(*page, Object);
+        if (!(page->InUse[index / 64] & (1ULL << (index % 64))))
+            throw OAException(OAException::E_MULTIPLE_FREE, "Multiple Free, you tried to free object twice");
+    }
+
+    //Check for Padding corruption
+    if (!PadsIntact(Object))
+        throw OAException(OAException::E_CORRUPTED_BLOCK, "Corrupted");
+}
+
+/**
+ * @brief Checks the left and right pads of a block
+ * 
+ * @param Object start of the block
+ * @return true if both pads still hold PAD_PATTERN
+ */
+bool ObjectAllocator::PadsIntact(const void* Object) const
+{
+    unsigned pdBytes = configuration_.PadBytes_;
+    const unsigned char* ptr1 = reinterpret_cast<const unsigned char*>(Object) - pdBytes;
+    const unsigned char* ptr2 = ptr1 + stats_.ObjectSize_ + pdBytes;
+    return PatternMatches(ptr1, pdBytes, PAD_PATTERN) && PatternMatches(ptr2, pdBytes, PAD_PATTERN);
+}
+
+/**
+ * @brief Finds the header of a block, right before its left pad or in the side table of its page
+ * 
+ * @param page page holding the block, null if it is on none
+ * @param Object start of the block
+ * @return char* first header byte, null with SideHeaders_ and no page
+ */
+char* ObjectAllocator::HeaderOf(const PageInfo* page, const void* Object) const
+{
+    size_t hdBytes = configuration_.HBlockInfo_.size_;
+    if (!configuration_.SideHeaders_)
+        return const_cast<char*>(reinterpret_cast<const char*>(Object)) - configuration_.PadBytes_ - hdBytes;
+    if (!page)
+        return nullptr;
+    return reinterpret_cast<char*>(const_cast<unsigned char*>(page->Side.data())) + BlockIndex(*page, Object) * hdBytes;
+}
+
+/**
+ * @brief Marks a block that was just taken from the free list as used: page bitmap, signature and header
+ * 
+ * @param page page holding the block, null to look it up only if the bitmap or the headers need it
+ * @param Object block handed to the client
+ * @param AllocNum allocation number stored in the header
+ * @param label label for external headers, already interned (or the client's own with StaticLabels_)
+ */
+void ObjectAllocator::MarkAllocated(PageInfo* page, void* Object, unsigned AllocNum, const char* label)
+{
+    bool State = configuration_.DebugOn_;
+    size_t hdBytes = configuration_.HBlockInfo_.size_;
+    bool external = configuration_.HBlockInfo_.type_ == OAConfig::hbExternal;
+    if (!page && (State || external || configuration_.SideHeaders_))
+        page = FindPage(Object);
+
+    //Mark the block as used in its page, only the debug checks read the bitmap as they go (RebuildInUse)
+    if (State)
+    {
+        unsigned index = BlockIndex(*page, Object);
+        page->InUse[index / 64] |= 1ULL << (index % 64);
+        page->Live++;
+    }
+
+    if(State)
+        memset(Object, ALLOCATED_PATTERN, stats_.ObjectSize_);
+
+    //Header
+    unsigned int* ptr;
+    short* counter;
+    char* header = HeaderOf(page, Object);
+    if (configuration_.HBlockInfo_.type_ != OAConfig::hbNone)
+    {
+        if (configuration_.HBlockInfo_.type_ == OAConfig::hbBasic && State)
+        {
+            ptr = reinterpret_cast<unsigned int*>(header);
+            *ptr = AllocNum;
+            *(header + 4) = 1;
+        }
+        else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExtended && State)
+        {
+            //user defined bytes, use counter, allocation number, flag
+            size_t additional = configuration_.HBlockInfo_.additional_;
+            counter = reinterpret_cast<short*>(header + additional);
+            (*counter)++;
+            ptr = reinterpret_cast<unsigned int*>(header + additional + sizeof(short));
+            *ptr = AllocNum;
+            *(header + hdBytes - 1) = 1;
+        }
+        else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExternal)
+        {
+            //The record of this block was created with its page, labels are shared
+            MemBlockInfo* info = &page->Headers[BlockIndex(*page, Object)];
+            info->in_use = 1;
+            info->alloc_num = AllocNum;
+            info->label = const_cast<char*>(label);
+            *reinterpret_cast<MemBlockInfo**>(header) = info;
+        }
+    }
+}
 
-            //Is it in use
-            GenericObject* temp1 = FreeList_;
-            bool in_use = true;
-            for (unsigned int i = 0; i < stats_.FreeObjects_; i++)
+/**
+ * @brief Marks a block that is going back to the free list as free: page bitmap, signature and header
+ * 
+ * @param page page holding the block, null if it is on none
+ * @param Object block given back by the client
+ */
+void ObjectAllocator::MarkFreed(PageInfo* page, void* Object)
+{
+    bool State = configuration_.DebugOn_;
+    size_t hdBytes = configuration_.HBlockInfo_.size_;
+
+    if (State)
+        memset(reinterpret_cast<char*>(Object), FREED_PATTERN, stats_.ObjectSize_);
+
+    //Mark the block as free in its page, CheckFree made sure it is a block of it
+    if (State)
+    {
+        unsigned index = BlockIndex(*page, Object);
+        page->InUse[index / 64] &= ~(1ULL << (index % 64));
+        page->Live--;
+    }
+
+    //Header
+    char* header = HeaderOf(page, Object);
+    if (header && configuration_.HBlockInfo_.type_ != OAConfig::hbNone)
+    {
+        if (configuration_.HBlockInfo_.type_ == OAConfig::hbBasic && State)
+        {
+
+            *reinterpret_cast<unsigned int*>(header) = 0;
+            *(header + 4) = 0;
+        }
+        else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExtended && State)
+        {
+            size_t additional = configuration_.HBlockInfo_.additional_;
+            *reinterpret_cast<unsigned int*>(header + additional + sizeof(short)) = 0;
+            *(header + hdBytes - 1) = 0;
+        }
+        else if (configuration_.HBlockInfo_.type_ == OAConfig::hbExternal)
+        {
+            //The record stays with the page, the block just stops pointing to it, the label stays interned
+            MemBlockInfo** headerPtr = reinterpret_cast<MemBlockInfo**>(header);
+            if ((*headerPtr))
             {
-                if (object == temp1)
-                {
-                    in_use = false;
-                    break;
-                }
-                temp1 = temp1->Next;
+                (*headerPtr)->in_use = 0;
+                (*headerPtr)->label = nullptr;
+                *headerPtr = nullptr;
             }
-            if (in_use)
+        }
+
+    }
+}
+
+/**
+ * @brief Without DebugOn_ Allocate and Free leave the in use bits and live counts alone, this brings them
+ *      up to date from the free lists and the quarantine for the calls that read them (O(free blocks))
+ * 
+ */
+void ObjectAllocator::RebuildInUse(void) const
+{
+    if (configuration_.DebugOn_ || configuration_.UseCPPMemManager_)
+        return;
+
+    //Every carved block in use, then the free ones cleared
+    for (size_t p = 0; p < PageTable_.size(); p++)
+    {
+        const PageInfo& page = PageTable_[p];
+        std::fill(page.InUse.begin(), page.InUse.end(), 0);
+        for (unsigned i = 0; i < page.Carved; i++)
+            page.InUse[i / 64] |= 1ULL << (i % 64);
+        page.Live = page.Carved;
+    }
+
+    const PageInfo* page = nullptr;
+    for (const GenericObject* block = FreeList_; block; block = block->Next)
+    {
+        if (!OnPage(page, block))
+            page = FindPage(block);
+        ClearInUse(*page, block);
+    }
+    for (size_t p = 0; p < PageTable_.size(); p++)
+    {
+        for (const GenericObject* block = PageTable_[p].Free; block; block = block->Next)
+            ClearInUse(PageTable_[p], block);
+    }
+    for (size_t i = 0; i < stats_.Quarantined_; i++)
+    {
+        const GenericObject* block = Quarantine_[(QuarantineHead_ + i) % Quarantine_.size()];
+        ClearInUse(*FindPage(block), block);
+    }
+}
+
+/**
+ * @brief Clears the in use bit of a free block found by RebuildInUse
+ * 
+ * @param page page holding the block
+ * @param Object the block
+ */
+void ObjectAllocator::ClearInUse(const PageInfo& page, const void* Object) const
+{
+    unsigned index = BlockIndex(page, Object);
+    page.InUse[index / 64] &= ~(1ULL << (index % 64));
+    page.Live--;
+}
+
+/**
+ * @brief Checks if an address is inside a page, so batches can skip the page table lookup
+ * 
+ * @param page page to check, can be null
+ * @param Object address to look for
+ * @return true if Object is on the page
+ */
+bool ObjectAllocator::OnPage(const PageInfo* page, const void* Object) const
+{
+    const char* address = reinterpret_cast<const char*>(Object);
+    return page && address >= page->Page && address < page->Page + stats_.PageSize_;
+}
+
+
+/**
+ * @brief Calls the callback fn for each block still in use
+ * 
+ * @param fn Dump callback function
+ * @return unsigned counter of dumps
+ */
+unsigned ObjectAllocator::DumpMemoryInUse(DUMPCALLBACK fn) const
+{
+    RebuildInUse();
+    unsigned count = 0;
+    GenericObject* temp = PageList_;
+    while(temp)
+    {
+        char* itr = reinterpret_cast<char*>(temp);
+        const PageInfo* page = FindPage(itr);
+
+        //Only visit the set bits of the in use bitmap
+        for (size_t w = 0; w < page->InUse.size(); w++)
+        {
+            unsigned long long word = page->InUse[w];
+            while (word)
             {
+                unsigned i = static_cast<unsigned>(w * 64) + LowestBit(word);
+                word &= word - 1;
+
                 //Call to funtion and add to counter
                 count++;
-                fn(object, stats_.ObjectSize_);
+                fn(itr + FirstBlock_ + i * BlockStride_, stats_.ObjectSize_);
             }
         }
         temp = temp->Next;
     }
-return count;
+    return count;
 }
 
 
@@ -488,8 +1211,6 @@ unsigned ObjectAllocator::ValidatePages(VALIDATECALLBACK fn) const
         return 0;
 
     unsigned count= 0;
-    unsigned pdBytes = configuration_.PadBytes_;
-    size_t hdBytes = configuration_.HBlockInfo_.size_;
 
     //Have to check through the pad bites to see if any of them where corrupted
     GenericObject* other = PageList_;
@@ -498,47 +1219,320 @@ unsigned ObjectAllocator::ValidatePages(VALIDATECALLBACK fn) const
     while (other)
     {
         unsigned char* temp = reinterpret_cast<unsigned char*>(other);
-        //Look for every pair of padds per object in the page
-        for (unsigned int i = 0; i < configuration_.ObjectsPerPage_; i++)
+        //Look for every pair of padds per object in the page (lazy pages only the ones carved)
+        unsigned carved = FindPage(other)->Carved;
+        for (unsigned int i = 0; i < carved; i++)
         {
-            //Find both of the pads and store them
-            unsigned char* ptr1 = temp + sizeof(void*) + hdBytes + i * (stats_.ObjectSize_ + 2 * pdBytes + hdBytes);
-            unsigned char* ptr2 = ptr1 + stats_.ObjectSize_ + pdBytes;
-            for (size_t i = 0; i < pdBytes; i++)
+            //Compare pads
+            unsigned char* object = temp + FirstBlock_ + i * BlockStride_;
+            if (!PadsIntact(object))
             {
-                //Compare pads
-                if (ptr1[i] != PAD_PATTERN)
-                {
-                    //Corruped
-                    fn(ptr1 + pdBytes, stats_.ObjectSize_);
-                    count++;
-                    break;
-                }
-                if (ptr2[i] != PAD_PATTERN)
-                {
-                    //Corrputed
-                    fn(ptr1 + pdBytes, stats_.ObjectSize_);
-                    count++;
-                    break;
-                }
+                //Corrupted
+                fn(object, stats_.ObjectSize_);
+                count++;
             }
-            
         }
         other = other->Next;
     }
     return count;
 }
 
-// Frees all empty pages (extra credit)
+/**
+ * @brief Incremental ValidatePages, checks up to a budget of blocks or time and remembers where it stopped
+ *      Pages are visited by address, so pages created or freed between calls don't break the cursor
+ * 
+ * @param fn Validate callback function
+ * @param cursor where the previous call stopped, updated for the next one
+ * @param MaxBlocks blocks to check at most in this call (0 = no limit)
+ * @param MaxNanoseconds time to spend at most in this call (0 = no limit), checked every 64 blocks
+ * @return unsigned corrupted blocks found in this call
+ */
+unsigned ObjectAllocator::ValidatePages(VALIDATECALLBACK fn, OAValidateCursor& cursor, unsigned MaxBlocks,
+                                        unsigned long long MaxNanoseconds) const
+{
+    if (!configuration_.DebugOn_ || !configuration_.PadBytes_ || PageTable_.empty())
+        return 0;
+
+    typedef std::chrono::steady_clock clock;
+    clock::time_point deadline = clock::now() + std::chrono::nanoseconds(MaxNanoseconds);
+
+    //First page at or after the cursor, a page freed since the last call is skipped
+    size_t p = 0;
+    size_t high = PageTable_.size();
+    while (cursor.Page && p < high)
+    {
+        size_t middle = (p + high) / 2;
+        if (PageTable_[middle].Page < cursor.Page)
+            p = middle + 1;
+        else
+            high = middle;
+    }
+    unsigned i = cursor.Block;
+    if (p == PageTable_.size() || PageTable_[p].Page != cursor.Page)
+        i = 0;
+
+    unsigned count = 0;
+    unsigned checked = 0;
+    while (!MaxBlocks || checked < MaxBlocks)
+    {
+        //End of the sweep, the next call starts over
+        if (p == PageTable_.size())
+        {
+            cursor.Page = nullptr;
+            cursor.Block = 0;
+            cursor.Sweeps++;
+            return count;
+        }
+
+        const PageInfo& page = PageTable_[p];
+        if (i >= page.Carved)
+        {
+            p++;
+            i = 0;
+            continue;
+        }
+
+        const char* object = page.Page + FirstBlock_ + i * BlockStride_;
+        if (!PadsIntact(object))
+        {
+            fn(object, stats_.ObjectSize_);
+            count++;
+        }
+        i++;
+        checked++;
+
+        if (MaxNanoseconds && checked % 64 == 0 && clock::now() >= deadline)
+            break;
+    }
+
+    cursor.Page = p < PageTable_.size() ? PageTable_[p].Page : nullptr;
+    cursor.Block = i;
+    return count;
+}
+
+/**
+ * @brief Calls the callback fn for each block still in use, the pages are scanned by several threads
+ * 
+ * @param fn Dump callback function, called on this thread in address order
+ * @param Threads number of workers (0 = one per core)
+ * @return unsigned counter of dumps
+ */
+unsigned ObjectAllocator::DumpMemoryInUse(DUMPCALLBACK fn, unsigned Threads) const
+{
+    RebuildInUse();
+    return ScanParallel(&ObjectAllocator::BlocksInUse, fn, Threads);
+}
+
+/**
+ * @brief Calls the callback fn for each block that is potentially corrupted, the pages are scanned by several threads
+ * 
+ * @param fn Validate callback function, called on this thread in address order
+ * @param Threads number of workers (0 = one per core)
+ * @return unsigned number of corrupted blocks
+ */
+unsigned ObjectAllocator::ValidatePages(VALIDATECALLBACK fn, unsigned Threads) const
+{
+    if (!configuration_.DebugOn_ || !configuration_.PadBytes_)
+        return 0;
+    return ScanParallel(&ObjectAllocator::CorruptedBlocks, fn, Threads);
+}
+
+/**
+ * @brief Finds the blocks in use of a range of pages from their bitmaps
+ * 
+ * @param First first page of the page table to scan
+ * @param Last one past the last page
+ * @param Blocks receives the blocks in use, in address order
+ */
+void ObjectAllocator::BlocksInUse(size_t First, size_t Last, std::vector<const char*>& Blocks) const
+{
+    for (size_t p = First; p < Last; p++)
+    {
+        const PageInfo& page = PageTable_[p];
+        for (size_t w = 0; w < page.InUse.size(); w++)
+        {
+            unsigned long long word = page.InUse[w];
+            while (word)
+            {
+                unsigned i = static_cast<unsigned>(w * 64) + LowestBit(word);
+                word &= word - 1;
+                Blocks.push_back(page.Page + FirstBlock_ + i * BlockStride_);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Finds the blocks with corrupted pads of a range of pages
+ * 
+ * @param First first page of the page table to scan
+ * @param Last one past the last page
+ * @param Blocks receives the corrupted blocks, in address order
+ */
+void ObjectAllocator::CorruptedBlocks(size_t First, size_t Last, std::vector<const char*>& Blocks) const
+{
+    for (size_t p = First; p < Last; p++)
+    {
+        const PageInfo& page = PageTable_[p];
+        for (unsigned i = 0; i < page.Carved; i++)
+        {
+            const char* object = page.Page + FirstBlock_ + i * BlockStride_;
+            if (!PadsIntact(object))
+                Blocks.push_back(object);
+        }
+    }
+}
+
+/**
+ * @brief Splits the page table in contiguous ranges, one per worker, and calls fn for what they found
+ *      The calling thread scans the first range itself, the callbacks only run once every worker is done
+ * 
+ * @param Scan what each worker does with its pages
+ * @param fn callback for every block found, called on this thread in address order
+ * @param Threads number of workers (0 = one per core)
+ * @return unsigned number of blocks found
+ */
+unsigned ObjectAllocator::ScanParallel(PAGESCAN Scan, void (*fn)(const void*, size_t), unsigned Threads) const
+{
+    if (!Threads)
+        Threads = std::thread::hardware_concurrency();
+    size_t pages = PageTable_.size();
+    size_t workers = Threads ? Threads : 1;
+    if (workers > pages)
+        workers = pages ? pages : 1;
+
+    std::vector<std::vector<const char*> > found(workers);
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < workers; w++)
+    {
+        size_t first = pages * w / workers;
+        size_t last = pages * (w + 1) / workers;
+        try
+        {
+            threads.push_back(std::thread(Scan, this, first, last, std::ref(found[w])));
+        }
+        catch (const std::system_error&)
+        {
+            //Out of threads, this one does the range
+            (this->*Scan)(first, last, found[w]);
+        }
+    }
+    (this->*Scan)(0, pages / workers, found[0]);
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+
+    //Merge in worker order, which is address order
+    unsigned count = 0;
+    for (size_t w = 0; w < workers; w++)
+    {
+        for (size_t b = 0; b < found[w].size(); b++)
+            fn(found[w][b], stats_.ObjectSize_);
+        count += static_cast<unsigned>(found[w].size());
+    }
+    return count;
+}
+
+/**
+ * @brief Frees all empty pages, the live counter of each page tells which ones are empty
+ * 
+ * @return unsigned number of pages freed
+ */
 unsigned ObjectAllocator::FreeEmptyPages(void)
 {
-    return 0;
+    if (configuration_.UseCPPMemManager_)
+        return 0;
+    RebuildInUse();
+
+    //The empty pages by address, usually far fewer than all of them. Nothing else is touched when there are none
+    std::vector<const char*> emptyPages;
+    for (size_t i = 0; i < PageTable_.size(); i++)
+    {
+        if (PageTable_[i].Live == 0)
+            emptyPages.push_back(PageTable_[i].Page);
+    }
+    unsigned empty = static_cast<unsigned>(emptyPages.size());
+    if (!empty)
+        return 0;
+
+    //Drop the quarantined blocks of the empty pages, keeping the order of the rest
+    size_t kept = 0;
+    for (size_t i = 0; i < stats_.Quarantined_; i++)
+    {
+        GenericObject* block = Quarantine_[(QuarantineHead_ + i) % Quarantine_.size()];
+        if (!EmptyPageOf(emptyPages, block))
+            Quarantine_[(QuarantineHead_ + kept++) % Quarantine_.size()] = block;
+    }
+    unsigned dropped = stats_.Quarantined_ - static_cast<unsigned>(kept);
+    stats_.Quarantined_ = static_cast<unsigned>(kept);
+
+    //Rebuild the free list in one pass without the blocks of the empty pages, keeping the order of the rest.
+    //Runs of blocks from the same page only look the page up once
+    GenericObject** link = &FreeList_;
+    const char* run = nullptr;
+    while (*link && !configuration_.SlabPages_)
+    {
+        const char* block = reinterpret_cast<const char*>(*link);
+        if (!run || block < run || block >= run + stats_.PageSize_)
+            run = EmptyPageOf(emptyPages, block);
+        if (run)
+            *link = (*link)->Next;
+        else
+            link = &(*link)->Next;
+    }
+
+    //Unlink the empty pages from the page list
+    link = &PageList_;
+    while (*link)
+    {
+        GenericObject* page = *link;
+        if (FindPage(page)->Live == 0)
+            *link = page->Next;
+        else
+            link = &page->Next;
+    }
+
+    //Release them and drop them from the page table
+    kept = 0;
+    for (size_t i = 0; i < PageTable_.size(); i++)
+    {
+        if (PageTable_[i].Live != 0)
+            std::swap(PageTable_[kept++], PageTable_[i]);
+        else
+        {
+            if (PageTable_[i].Page == Bump_)
+                Bump_ = nullptr;
+            ReleasePage(PageTable_[i].Raw);
+        }
+    }
+    PageTable_.resize(kept);
+
+    //The slots of the pages left changed, list them again
+    if (configuration_.SlabPages_)
+    {
+        for (size_t i = 0; i < Slabs_.size(); i++)
+            Slabs_[i].clear();
+        for (size_t i = 0; i < PageTable_.size(); i++)
+        {
+            PageTable_[i].Slot = static_cast<unsigned>(Slabs_[PageTable_[i].Available].size());
+            Slabs_[PageTable_[i].Available].push_back(PageTable_[i].Page);
+        }
+        SlabLow_ = 1;
+    }
+
+    //Update stats
+    stats_.FreeObjects_ -= empty * configuration_.ObjectsPerPage_ - dropped;
+    stats_.PagesInUse_ -= empty;
+    return empty;
 }
 
-// Returns true if FreeEmptyPages and alignments are implemented
+/**
+ * @brief Returns true if FreeEmptyPages and alignments are implemented
+ * 
+ * @return true 
+ */
 bool ObjectAllocator::ImplementedExtraCredit(void)
 {
-    return false;
+    return true;
 }
 
 /**
@@ -548,6 +1542,8 @@ bool ObjectAllocator::ImplementedExtraCredit(void)
  */
 void         ObjectAllocator::SetDebugState(bool State)
 {
+    //The double free checks need the bitmap up to date from here on
+    RebuildInUse();
     configuration_.DebugOn_ = State;
 }
     
@@ -579,6 +1575,32 @@ OAConfig     ObjectAllocator::GetConfig(void) const
 {
     return configuration_;
 }    
+/**
+ * @brief Header of a block, found the same way with inline headers and with SideHeaders_
+ * 
+ * @param Object block handed to the client
+ * @return const void* first header byte, null if there are no headers or Object is not on a page
+ */
+const void*  ObjectAllocator::GetHeader(const void* Object) const
+{
+    if (configuration_.UseCPPMemManager_ || !configuration_.HBlockInfo_.size_)
+        return nullptr;
+    const PageInfo* page = FindPage(Object);
+    if (!page)
+        return nullptr;
+    return HeaderOf(page, Object);
+}
+
+/**
+ * @brief Number of distinct labels stored for external headers, they are kept until the allocator is destroyed
+ * 
+ * @return size_t 0 with StaticLabels_, labels are not stored then
+ */
+size_t       ObjectAllocator::GetLabelCount(void) const
+{
+    return Labels_.Count();
+}
+
 /**
  * @brief returns the statistics for the allocator
  * 
@@ -5,6 +5,10 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+#include "PageProvider.h"
 
 // If the client doesn't specify these:
 static const int DEFAULT_OBJECTS_PER_PAGE = 4;
@@ -93,6 +97,17 @@ struct OAConfig
         HBlockInfo_     = HBInfo;
         LeftAlignSize_  = 0;
         InterAlignSize_ = 0;
+        LazyPages_      = false;
+        MmapPages_      = false;
+        HugePages_      = false;
+        PopulatePages_  = false;
+        PageProvider_   = nullptr;
+        StaticLabels_   = false;
+        GuardPages_     = false;
+        QuarantineObjects_ = 0;
+        QuarantineBytes_   = 0;
+        SlabPages_      = false;
+        SideHeaders_    = false;
     }
 
     bool            UseCPPMemManager_; // by-pass the functionality of the OA and use new/delete
@@ -105,13 +120,31 @@ struct OAConfig
 
     unsigned LeftAlignSize_;  // number of alignment bytes required to align first block
     unsigned InterAlignSize_; // number of alignment bytes required between remaining blocks
+
+    // Optional behavior, set after construction
+    bool LazyPages_;     // new pages hand out their blocks in order from a bump cursor, only freed blocks go on the free list
+    bool MmapPages_;     // pages come straight from the OS (mmap/VirtualAlloc), PageSize_ is rounded to OS pages
+    bool HugePages_;     // with MmapPages_, ask for transparent huge pages (ignored where unsupported)
+    bool PopulatePages_; // with MmapPages_, fault the whole page in when it is created
+    PageProvider * PageProvider_; // where pages come from (null = heap, or the OS with MmapPages_), must outlive the allocator
+    bool StaticLabels_;  // labels of external headers outlive the allocator (string literals), kept as given instead of interned
+    bool GuardPages_;    // every page ends on an inaccessible OS page, so overflowing its last object faults (ignored with PageProvider_)
+                         // use 1 object per page and no pads to guard every object, Alignment_ can leave a gap before the guard
+    unsigned QuarantineObjects_; // freed blocks held back from reuse, filled with FREED_PATTERN (0 = no limit by count)
+    size_t   QuarantineBytes_;   // same, limited by their bytes (0 = no limit by bytes), both 0 = no quarantine
+                                 // a limit holds at least one block, the slots are only allocated as blocks come in
+    bool SlabPages_;     // free blocks stay on their page and come from the fullest page first, so pages empty out
+                         // (GetFreeList is null, LazyPages_ is ignored)
+    bool SideHeaders_;   // headers go in a table next to the page instead of before each object, objects keep their
+                         // natural stride (plus pads), GetHeader finds them
 };
 
 // ObjectAllocator statistical info
 struct OAStats
 {
     OAStats(void) :
-        ObjectSize_(0), PageSize_(0), FreeObjects_(0), ObjectsInUse_(0), PagesInUse_(0), MostObjects_(0), Allocations_(0), Deallocations_(0) {};
+        ObjectSize_(0), PageSize_(0), FreeObjects_(0), ObjectsInUse_(0), PagesInUse_(0), MostObjects_(0), Allocations_(0), Deallocations_(0),
+        Quarantined_(0) {};
 
     size_t   ObjectSize_;    // size of each object
     size_t   PageSize_;      // size of a page including all headers, padding, etc.
@@ -121,6 +154,17 @@ struct OAStats
     unsigned MostObjects_;   // most objects in use by client at one time
     unsigned Allocations_;   // total requests to allocate memory
     unsigned Deallocations_; // total requests to free memory
+    unsigned Quarantined_;   // freed objects waiting in the quarantine (not on the free list)
+};
+
+// Where an incremental ValidatePages stopped, owned by the client (start with a default constructed one)
+struct OAValidateCursor
+{
+    OAValidateCursor(void) : Page(0), Block(0), Sweeps(0) {};
+
+    const char * Page;   // page to resume at (the next one by address if it was freed), null = first page
+    unsigned     Block;  // block of that page to resume at
+    unsigned     Sweeps; // times every page has been checked
 };
 
 // This allows us to easily treat raw objects as nodes in a linked list
@@ -132,10 +176,42 @@ struct GenericObject
 struct MemBlockInfo
 {
     bool     in_use;    // Is the block free or in use?
-    char *   label;     // A dynamically allocated NUL-terminated string
+    char *   label;     // A NUL-terminated string interned by the allocator (the client's own with StaticLabels_)
     unsigned alloc_num; // The allocation number (count) of this block
 };
 
+// Labels of external headers, every distinct label is stored once and kept until the
+// owner is destroyed, so blocks that come and go with the same label copy it only once. Not thread safe.
+class OALabels
+{
+  public:
+    OALabels(void) {};
+
+    // Frees every label stored (never throws)
+    ~OALabels();
+
+    // Shared copy of label
+    // Throws an exception if the copy can't be allocated. (Memory allocation problem)
+    char * Intern(const char * label);
+
+    size_t Count(void) const; // distinct labels stored
+
+  private:
+    struct Hash
+    {
+        size_t operator()(const char * label) const; // FNV-1a of the string
+    };
+    struct Equal
+    {
+        bool operator()(const char * lhs, const char * rhs) const; // same string
+    };
+    std::unordered_set<const char *, Hash, Equal> labels_; // owns the strings
+
+    // Make private to prevent copy construction and assignment
+    OALabels(const OALabels & l);
+    OALabels & operator=(const OALabels & l);
+};
+
 // This memory manager class
 class ObjectAllocator
 {
@@ -164,14 +240,39 @@ class ObjectAllocator
 
     // Returns an object to the free list for the client (simulates delete)
     // Throws an exception if the the object can't be freed. (Invalid object)
+    // With a quarantine the object waits there first, and the oldest one goes to the free list. It throws
+    // E_CORRUPTED_BLOCK if that one was written while it waited (it is still freed)
     void Free(void * Object);
 
+    // Takes n objects from the free list at once and stores them in out
+    // Throws an exception if the objects can't be allocated, nothing is allocated then. (Memory allocation problem)
+    // E_NO_PAGES is thrown before any page is created
+    void AllocateBatch(size_t n, void ** out);
+
+    // Returns n objects to the free list at once
+    // Throws an exception if one of the objects can't be freed, the ones before it are freed. (Invalid object)
+    // With a quarantine they are freed one by one like Free, so the one that throws is freed too
+    void FreeBatch(void ** ptrs, size_t n);
+
     // Calls the callback fn for each block still in use
     unsigned DumpMemoryInUse(DUMPCALLBACK fn) const;
 
+    // Same as DumpMemoryInUse with the pages split among Threads workers (0 = one per core).
+    // fn runs on the calling thread, for the blocks in address order
+    unsigned DumpMemoryInUse(DUMPCALLBACK fn, unsigned Threads) const;
+
     // Calls the callback fn for each block that is potentially corrupted
     unsigned ValidatePages(VALIDATECALLBACK fn) const;
 
+    // Same checks, resuming at cursor and stopping after MaxBlocks blocks or MaxNanoseconds (0 = no limit
+    // for either), or at the end of a sweep. Returns the corrupted blocks found in this call
+    unsigned ValidatePages(VALIDATECALLBACK fn, OAValidateCursor & cursor, unsigned MaxBlocks,
+                           unsigned long long MaxNanoseconds = 0) const;
+
+    // Same as ValidatePages with the pages split among Threads workers (0 = one per core).
+    // fn runs on the calling thread, for the blocks in address order
+    unsigned ValidatePages(VALIDATECALLBACK fn, unsigned Threads) const;
+
     // Frees all empty pages (extra credit)
     unsigned FreeEmptyPages(void);
 
@@ -180,10 +281,12 @@ class ObjectAllocator
 
     // Testing/Debugging/Statistic methods
     void         SetDebugState(bool State); // true=enable, false=disable
-    const void * GetFreeList(void) const;   // returns a pointer to the internal free list
+    const void * GetFreeList(void) const;   // returns a pointer to the internal free list (null with SlabPages_)
     const void * GetPageList(void) const;   // returns a pointer to the internal page list
     OAConfig     GetConfig(void) const;     // returns the configuration parameters
     OAStats      GetStats(void) const;      // returns the statistics for the allocator
+    const void * GetHeader(const void * Object) const; // header bytes of Object, inline or in the side table (null if none)
+    size_t       GetLabelCount(void) const; // distinct labels stored for external headers so far
 
     
 
@@ -196,6 +299,73 @@ class ObjectAllocator
     OAConfig        configuration_;
     OAStats         stats_;
     void         CreatePage(GenericObject*& FreeList_, GenericObject*& PageList_);
+    size_t       FirstBlock_;  // offset from the start of a page to its first object
+    size_t       BlockStride_; // offset from one object to the next (header, pads and alignment)
+    size_t       HeaderBytes_; // header bytes before each object, 0 with SideHeaders_
+    char *       Bump_;        // page carving blocks with LazyPages_, null to look for the next one
+    size_t       AllocSize_;   // bytes requested for each page (alignment slack and provider rounding included)
+    PageProvider * provider_;                      // where pages come from
+    std::unique_ptr<PageProvider> ownedProvider_;  // provider created for GuardPages_ or MmapPages_, null otherwise
+    char *       AcquirePage(void);          // memory for one page from provider_, throws E_NO_MEMORY
+    void         ReleasePage(char * Raw);     // gives back what AcquirePage returned
+    void         InitBlock(char * Object, unsigned Index, bool Unallocated); // alignment, header and pads of a block
+
+    // Bookkeeping for one page, kept outside the page so the page layout is unchanged
+    struct PageInfo
+    {
+        char *                          Page;    // start of the page
+        char *                          Raw;     // what new returned (before aligning Page)
+        mutable unsigned                Live;    // blocks of this page the client owns (see RebuildInUse)
+        unsigned                        Carved;  // blocks initialized so far (all of them unless LazyPages_)
+        mutable std::vector<unsigned long long> InUse; // one bit per block, set while the client owns it (see RebuildInUse)
+        std::vector<MemBlockInfo>       Headers; // external header of each block (hbExternal only), created with the page
+        std::vector<unsigned char>      Side;      // header of each block by slot (SideHeaders_ only), created with the page
+        GenericObject *                 Free;      // free blocks of this page (SlabPages_ only)
+        unsigned                        Available; // blocks on Free, the slab list the page is on
+        unsigned                        Slot;      // position of the page in that list
+    };
+    std::vector<PageInfo> PageTable_;                     // every page, sorted by address
+    PageInfo *   FindPage(const void * Object);           // page holding Object, or null
+    const PageInfo * FindPage(const void * Object) const;
+    unsigned     BlockIndex(const PageInfo & Page, const void * Object) const; // slot of Object in Page
+    GenericObject * Carve(PageInfo *& page);                                   // next block of the Bump_ page, and that page
+    bool         OnPage(const PageInfo * page, const void * Object) const;      // true if Object is on page
+    const char * EmptyPageOf(const std::vector<const char *> & EmptyPages, const void * Object) const; // for FreeEmptyPages
+
+    void         CheckFree(PageInfo * page, void * Object) const; // debug checks before freeing, throws
+    bool         PadsIntact(const void * Object) const;             // both pads of Object hold PAD_PATTERN
+    char *       HeaderOf(const PageInfo * page, const void * Object) const; // header of Object, before it or in page->Side
+
+    // Scans pages [First, Last) of the page table and appends the blocks found to Blocks
+    typedef void (ObjectAllocator::*PAGESCAN)(size_t First, size_t Last, std::vector<const char *> & Blocks) const;
+    void         BlocksInUse(size_t First, size_t Last, std::vector<const char *> & Blocks) const;
+    void         CorruptedBlocks(size_t First, size_t Last, std::vector<const char *> & Blocks) const;
+    unsigned     ScanParallel(PAGESCAN Scan, void (*fn)(const void *, size_t), unsigned Threads) const;
+    void         MarkAllocated(PageInfo * page, void * Object, unsigned AllocNum, const char * label);
+    void         MarkFreed(PageInfo * page, void * Object);
+
+    // Allocate and Free keep InUse and Live up to date only with DebugOn_, the double free checks need them
+    // as they go. The calls that read them otherwise (dumps, FreeEmptyPages) rebuild them from the free lists first
+    void         RebuildInUse(void) const;
+    void         ClearInUse(const PageInfo & page, const void * Object) const; // free block found by RebuildInUse
+
+    // Freed blocks held back from reuse, oldest first (a ring that grows up to QuarantineCap_ slots)
+    std::vector<GenericObject *> Quarantine_;
+    size_t       QuarantineHead_; // oldest block
+    size_t       QuarantineCap_;  // most blocks held back, 0 = no quarantine
+    void         Quarantine(GenericObject * Object); // holds a freed block back, evicting the oldest when full
+    void         GrowQuarantine(void);               // doubles the ring, up to QuarantineCap_
+    bool         Evict(void);                        // oldest block to the free list, false if its pattern was overwritten
+    void         PushFree(PageInfo * page, GenericObject * Object); // Object back on the free list (or its page's one)
+
+    // SlabPages_: Slabs_[n] holds the pages with n free blocks, 0 is the full list, ObjectsPerPage_ the empty
+    // one and the rest the partial ones. Pages move one list over with each block they hand out or get back
+    std::vector<std::vector<char *> > Slabs_;
+    unsigned     SlabLow_;  // no partial list below this one has pages
+    GenericObject * SlabPop(PageInfo *& page);           // block of the fullest page with one, and that page
+    void         SlabMove(PageInfo & page, unsigned Available); // page to the list of Available free blocks
+
+    OALabels     Labels_;       // labels of external headers (unless StaticLabels_)
 
     // Make private to prevent copy construction and assignment
     ObjectAllocator(const ObjectAllocator & oa);
@@ -0,0 +1,390 @@
+//---------------------------------------------------------------------------
+#ifndef OBJECTPOOLH
+#define OBJECTPOOLH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include "PageProvider.h"
+#include "PatternCheck.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Compile time configuration of an ObjectPool, the fields mean the same as in OAConfig.
+// There is no UseCPPMemManager_, a pool that just calls new/delete is not a pool.
+template <unsigned ObjectsPerPage = DEFAULT_OBJECTS_PER_PAGE,
+          unsigned MaxPages = DEFAULT_MAX_PAGES,
+          bool DebugOn = false,
+          unsigned PadBytes = 0,
+          OAConfig::HBLOCK_TYPE Header = OAConfig::hbNone,
+          unsigned HeaderAdditional = 0,
+          unsigned Alignment = 0>
+struct PoolPolicy
+{
+    static const unsigned              ObjectsPerPage_   = ObjectsPerPage;
+    static const unsigned              MaxPages_         = MaxPages; // 0=unlimited
+    static const bool                  DebugOn_          = DebugOn;
+    static const unsigned              PadBytes_         = PadBytes;
+    static const OAConfig::HBLOCK_TYPE Header_           = Header;
+    static const unsigned              HeaderAdditional_ = HeaderAdditional; // user-defined bytes of hbExtended
+    static const unsigned              Alignment_        = Alignment;
+};
+
+// Unlimited pages of 4096 objects without any debugging, the release mode pool
+typedef PoolPolicy<4096, 0> ReleasePoolPolicy;
+
+// Typed pool of T laid out like ObjectAllocator, but every OAConfig choice is a
+// template parameter. Stride and offsets are constants and the features the policy
+// leaves off are never compiled in, so with ReleasePoolPolicy Allocate and Free are
+// a free list pop and push plus the stats counters.
+//
+// Headers are kept whenever the policy has them. DebugOn_ adds the signatures and
+// the boundary, multiple free and padding checks of Free. Objects still alive when
+// the pool is destroyed are not destroyed, their memory is just released. Not thread
+// safe, same as ObjectAllocator.
+template <typename T, typename Policy = ReleasePoolPolicy>
+class ObjectPool
+{
+  public:
+    // Layout, same formulas as ObjectAllocator
+    static const size_t ObjectSize = sizeof(T) < sizeof(void *) ? sizeof(void *) : sizeof(T);
+    static const size_t PadBytes = Policy::PadBytes_;
+    static const size_t HeaderSize =
+        Policy::Header_ == OAConfig::hbBasic      ? OAConfig::BASIC_HEADER_SIZE
+        : Policy::Header_ == OAConfig::hbExtended ? sizeof(unsigned int) + sizeof(unsigned short) + sizeof(char) + Policy::HeaderAdditional_
+        : Policy::Header_ == OAConfig::hbExternal ? OAConfig::EXTERNAL_HEADER_SIZE
+                                                  : 0;
+    static const size_t Alignment = Policy::Alignment_ > alignof(T) ? Policy::Alignment_ : alignof(T);
+    static const size_t LeftAlignSize = Alignment > 1 ? (Alignment - (sizeof(void *) + HeaderSize + PadBytes) % Alignment) % Alignment : 0;
+    static const size_t InterAlignSize = Alignment > 1 ? (Alignment - (ObjectSize + 2 * PadBytes + HeaderSize) % Alignment) % Alignment : 0;
+    static const size_t FirstBlock = sizeof(void *) + LeftAlignSize + HeaderSize + PadBytes;
+    static const size_t BlockStride = ObjectSize + 2 * PadBytes + HeaderSize + InterAlignSize;
+    static const size_t PageSize = FirstBlock - HeaderSize - PadBytes + Policy::ObjectsPerPage_ * BlockStride - InterAlignSize;
+
+    static_assert(Policy::ObjectsPerPage_ > 0, "ObjectPool pages need at least one object");
+    static_assert((Alignment & (Alignment - 1)) == 0, "ObjectPool alignment must be a power of two");
+
+    // Creates the pool and its first page, pages come from Provider (null = heap), it must outlive the pool
+    // Throws an exception if the construction fails. (Memory allocation problem)
+    explicit ObjectPool(PageProvider * Provider = nullptr) :
+        free_(nullptr), pages_(nullptr), provider_(Provider ? Provider : &HeapPageProvider::Instance())
+    {
+        stats_.ObjectSize_ = ObjectSize;
+        stats_.PageSize_ = PageSize;
+        allocSize_ = PageSize;
+        if (Alignment > provider_->Alignment())
+            allocSize_ += Alignment - 1;
+        NewPage();
+    }
+
+    // Releases every page (never throws), external headers live in the page table
+    ~ObjectPool()
+    {
+        for (size_t p = 0; p < table_.size(); p++)
+            provider_->ReleasePage(table_[p].Raw, allocSize_);
+    }
+
+    // Raw memory for one T, label is only kept with hbExternal headers (interned, one copy per distinct label)
+    // Throws an exception if the object can't be allocated. (Memory allocation problem)
+    void * Allocate(const char * label = 0)
+    {
+        // Interned first, a failed copy leaves the pool as it was
+        if (Policy::Header_ == OAConfig::hbExternal && label)
+            label = labels_.Intern(label);
+        if (!free_)
+            NewPage();
+
+        GenericObject * block = free_;
+        free_ = block->Next;
+
+        stats_.FreeObjects_--;
+        stats_.ObjectsInUse_++;
+        if (stats_.ObjectsInUse_ > stats_.MostObjects_)
+            stats_.MostObjects_ = stats_.ObjectsInUse_;
+        stats_.Allocations_++;
+
+        if (Policy::DebugOn_)
+            memset(block, ObjectAllocator::ALLOCATED_PATTERN, ObjectSize);
+        if (HeaderSize)
+            MarkHeader(reinterpret_cast<char *>(block), true, label);
+        if (Policy::DebugOn_ && !HeaderSize)
+            SetInUse(reinterpret_cast<char *>(block), true);
+        return block;
+    }
+
+    // Gives back what Allocate returned
+    // Throws an exception if the the object can't be freed. (Invalid object, only checked with DebugOn_)
+    void Free(void * Object)
+    {
+        char * block = static_cast<char *>(Object);
+        if (Policy::DebugOn_)
+        {
+            CheckFree(block);
+            memset(block, ObjectAllocator::FREED_PATTERN, ObjectSize);
+            if (!HeaderSize)
+                SetInUse(block, false);
+        }
+        if (HeaderSize)
+            MarkHeader(block, false, 0);
+
+        GenericObject * node = reinterpret_cast<GenericObject *>(block);
+        node->Next = free_;
+        free_ = node;
+
+        stats_.FreeObjects_++;
+        stats_.ObjectsInUse_--;
+        stats_.Deallocations_++;
+    }
+
+    // Allocates a T and constructs it with args
+    // Throws an exception if the object can't be allocated, or whatever the constructor throws (nothing leaks)
+    template <typename... Args>
+    T * create(Args &&... args)
+    {
+        void * memory = Allocate();
+        try
+        {
+            return new (memory) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            Free(memory);
+            throw;
+        }
+    }
+
+    // Destroys an object made by create and gives its memory back (null does nothing)
+    void destroy(T * p)
+    {
+        if (!p)
+            return;
+        p->~T();
+        Free(p);
+    }
+
+    // Calls the callback fn for each block with corrupted pads, 0 unless DebugOn_ and PadBytes_
+    unsigned ValidatePages(ObjectAllocator::VALIDATECALLBACK fn) const
+    {
+        if (!Policy::DebugOn_ || !PadBytes)
+            return 0;
+
+        unsigned count = 0;
+        for (size_t p = 0; p < table_.size(); p++)
+        {
+            for (unsigned i = 0; i < Policy::ObjectsPerPage_; i++)
+            {
+                const char * block = table_[p].Page + FirstBlock + i * BlockStride;
+                if (!PadsIntact(block))
+                {
+                    fn(block, ObjectSize);
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
+    const void * GetFreeList(void) const { return free_; }  // returns a pointer to the internal free list
+    const void * GetPageList(void) const { return pages_; } // returns a pointer to the internal page list
+    OAStats      GetStats(void) const { return stats_; }    // returns the statistics for the pool
+    size_t       GetLabelCount(void) const { return labels_.Count(); } // distinct labels stored so far (hbExternal)
+
+  private:
+    // Bookkeeping for one page, kept outside the page like ObjectAllocator does
+    struct PageInfo
+    {
+        char *                          Page;  // start of the page
+        char *                          Raw;   // what the provider returned (before aligning Page)
+        std::vector<unsigned long long> InUse;   // one bit per block, only with DebugOn_ and no header
+        std::vector<MemBlockInfo>       Headers; // external header of each block, only with hbExternal
+    };
+
+    GenericObject *       free_;      // the beginning of the list of objects
+    GenericObject *       pages_;     // the beginning of the list of pages
+    std::vector<PageInfo> table_;     // every page, sorted by address
+    PageProvider *        provider_;  // where pages come from
+    size_t                allocSize_; // bytes requested for each page
+    OAStats               stats_;
+    OALabels              labels_;    // labels of external headers
+
+    // Allocates a page and threads its blocks on the free list, the first block ends up at the head
+    // Throws an exception if there are no pages left or no memory. (Memory allocation problem)
+    void NewPage(void)
+    {
+        if (Policy::MaxPages_ && stats_.PagesInUse_ >= Policy::MaxPages_)
+            throw OAException(OAException::E_NO_PAGES, "Couldnt allocate, max number of pages reached");
+
+        char * raw = provider_->AllocatePage(allocSize_);
+        if (!raw)
+            throw OAException(OAException::E_NO_MEMORY, "There is no memory, the page provider failed");
+        char * page = raw;
+        if (allocSize_ > PageSize)
+            page = raw + (Alignment - reinterpret_cast<uintptr_t>(raw) % Alignment) % Alignment;
+
+        PageInfo info;
+        info.Page = page;
+        info.Raw = raw;
+        if (Policy::DebugOn_ && !HeaderSize)
+            info.InUse.assign((Policy::ObjectsPerPage_ + 63) / 64, 0);
+        if (Policy::Header_ == OAConfig::hbExternal)
+            info.Headers.resize(Policy::ObjectsPerPage_);
+        typename std::vector<PageInfo>::iterator it = table_.begin();
+        while (it != table_.end() && it->Page < page)
+            ++it;
+        table_.insert(it, std::move(info));
+
+        reinterpret_cast<GenericObject *>(page)->Next = pages_;
+        pages_ = reinterpret_cast<GenericObject *>(page);
+
+        if (Policy::DebugOn_)
+            memset(page + sizeof(void *), ObjectAllocator::ALIGN_PATTERN, LeftAlignSize);
+        for (unsigned i = Policy::ObjectsPerPage_; i-- > 0;)
+        {
+            char * block = page + FirstBlock + i * BlockStride;
+            if (HeaderSize)
+                memset(block - PadBytes - HeaderSize, 0, HeaderSize);
+            if (Policy::DebugOn_)
+            {
+                if (i > 0)
+                    memset(block - PadBytes - HeaderSize - InterAlignSize, ObjectAllocator::ALIGN_PATTERN, InterAlignSize);
+                memset(block - PadBytes, ObjectAllocator::PAD_PATTERN, PadBytes);
+                memset(block + ObjectSize, ObjectAllocator::PAD_PATTERN, PadBytes);
+                memset(block + sizeof(void *), ObjectAllocator::UNALLOCATED_PATTERN, ObjectSize - sizeof(void *));
+            }
+            GenericObject * node = reinterpret_cast<GenericObject *>(block);
+            node->Next = free_;
+            free_ = node;
+        }
+
+        stats_.FreeObjects_ += Policy::ObjectsPerPage_;
+        stats_.PagesInUse_++;
+    }
+
+    // Page holding Object with a binary search on the page table, null if it is on none
+    PageInfo * FindPage(const char * Object)
+    {
+        size_t low = 0;
+        size_t high = table_.size();
+        while (low < high)
+        {
+            size_t middle = (low + high) / 2;
+            if (table_[middle].Page <= Object)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if (low == 0 || Object >= table_[low - 1].Page + PageSize)
+            return nullptr;
+        return &table_[low - 1];
+    }
+
+    // Writes the header of a block being handed out (Used) or given back
+    void MarkHeader(char * Object, bool Used, const char * label)
+    {
+        char * header = Object - PadBytes - HeaderSize;
+        if (Policy::Header_ == OAConfig::hbBasic)
+        {
+            unsigned num = Used ? stats_.Allocations_ : 0;
+            memcpy(header, &num, sizeof(num));
+            header[sizeof(unsigned)] = Used;
+        }
+        else if (Policy::Header_ == OAConfig::hbExtended)
+        {
+            char * counter = header + Policy::HeaderAdditional_;
+            char * num = counter + sizeof(unsigned short);
+            unsigned value = Used ? stats_.Allocations_ : 0;
+            if (Used)
+            {
+                unsigned short uses;
+                memcpy(&uses, counter, sizeof(uses));
+                uses++;
+                memcpy(counter, &uses, sizeof(uses));
+            }
+            memcpy(num, &value, sizeof(value));
+            header[HeaderSize - 1] = Used;
+        }
+        else if (Policy::Header_ == OAConfig::hbExternal)
+        {
+            if (!Used)
+            {
+                ClearExternal(Object);
+                return;
+            }
+
+            // The record of this block was created with its page, labels are shared
+            PageInfo * page = FindPage(Object);
+            MemBlockInfo * info = &page->Headers[(Object - page->Page - FirstBlock) / BlockStride];
+            info->in_use = true;
+            info->alloc_num = stats_.Allocations_;
+            info->label = const_cast<char *>(label);
+            memcpy(header, &info, sizeof(info));
+        }
+    }
+
+    // The block stops pointing to its external header, the record stays with the page
+    void ClearExternal(char * Object)
+    {
+        MemBlockInfo ** header = reinterpret_cast<MemBlockInfo **>(Object - PadBytes - HeaderSize);
+        if (*header)
+        {
+            (*header)->in_use = false;
+            (*header)->label = nullptr;
+            *header = nullptr;
+        }
+    }
+
+    // Flips the in use bit of a block on a page without header
+    void SetInUse(char * Object, bool Used)
+    {
+        PageInfo * page = FindPage(Object);
+        size_t index = (Object - page->Page - FirstBlock) / BlockStride;
+        if (Used)
+            page->InUse[index / 64] |= 1ULL << (index % 64);
+        else
+            page->InUse[index / 64] &= ~(1ULL << (index % 64));
+    }
+
+    // Both pads still hold PAD_PATTERN
+    bool PadsIntact(const char * Object) const
+    {
+        return PatternMatches(Object - PadBytes, PadBytes, ObjectAllocator::PAD_PATTERN) &&
+               PatternMatches(Object + ObjectSize, PadBytes, ObjectAllocator::PAD_PATTERN);
+    }
+
+    // Boundary, multiple free and padding checks of a block before freeing it, throws
+    void CheckFree(char * Object)
+    {
+        PageInfo * page = FindPage(Object);
+        if (!page)
+            throw OAException(OAException::E_BAD_BOUNDARY, "Bad boundary for Free, the adress given was not usable");
+        size_t position = Object - page->Page;
+        if (position < FirstBlock || (position - FirstBlock) % BlockStride != 0)
+            throw OAException(OAException::E_BAD_BOUNDARY, "Bad boundary for Free, the adress given was not usable");
+
+        bool used;
+        char * header = Object - PadBytes - HeaderSize;
+        if (Policy::Header_ == OAConfig::hbBasic || Policy::Header_ == OAConfig::hbExtended)
+            used = header[HeaderSize - 1] != 0;
+        else if (Policy::Header_ == OAConfig::hbExternal)
+            used = *reinterpret_cast<MemBlockInfo **>(header) != nullptr;
+        else
+        {
+            size_t index = (position - FirstBlock) / BlockStride;
+            used = (page->InUse[index / 64] & (1ULL << (index % 64))) != 0;
+        }
+        if (!used)
+            throw OAException(OAException::E_MULTIPLE_FREE, "Multiple Free, you tried to free object twice");
+
+        if (!PadsIntact(Object))
+            throw OAException(OAException::E_CORRUPTED_BLOCK, "Corrupted");
+    }
+
+    // Make private to prevent copy construction and assignment
+    ObjectPool(const ObjectPool & op);
+    ObjectPool & operator=(const ObjectPool & op);
+};
+
+#endif
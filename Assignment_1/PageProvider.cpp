@@ -0,0 +1,386 @@
+/**
+ * @file PageProvider.cpp
+ * @author Diego Lopez (diego.lopez@digipen.edu)
+ * @brief Sources of page memory for ObjectAllocator: heap, OS and preallocated arena
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "PageProvider.h"
+#include <cstdint>
+#include <new>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Transparent huge pages are 2MB on every platform that has them
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// What new char[] and the arena guarantee for the start of a page
+static const size_t HEAP_ALIGNMENT = alignof(std::max_align_t);
+
+/**
+ * @brief Bytes an arena page of the given size takes, whole aligned slots so the next page starts aligned too
+ *      and at least one, a released page keeps its list node in it
+ *
+ * @param Size bytes in the page
+ * @return size_t bytes of the slot (less than Size if rounding up overflowed)
+ */
+static size_t ArenaSlot(size_t Size)
+{
+    size_t slot = (Size + HEAP_ALIGNMENT - 1) / HEAP_ALIGNMENT * HEAP_ALIGNMENT;
+    return slot ? slot : HEAP_ALIGNMENT;
+}
+
+/**
+ * @brief Allocates a page with new
+ *
+ * @param Size bytes in the page
+ * @return char* the page, null if new failed
+ */
+char* HeapPageProvider::AllocatePage(size_t Size)
+{
+    return new (std::nothrow) char[Size];
+}
+
+/**
+ * @brief Deletes a page
+ *
+ * @param Page what AllocatePage returned
+ */
+void HeapPageProvider::ReleasePage(char* Page, size_t)
+{
+    delete[] Page;
+}
+
+/**
+ * @brief new only guarantees the fundamental alignment
+ *
+ * @return size_t alignof(std::max_align_t)
+ */
+size_t HeapPageProvider::Alignment(void) const
+{
+    return HEAP_ALIGNMENT;
+}
+
+/**
+ * @brief Shared provider for allocators that don't pick one, it has no state
+ *
+ * @return HeapPageProvider&
+ */
+HeapPageProvider& HeapPageProvider::Instance(void)
+{
+    static HeapPageProvider instance;
+    return instance;
+}
+
+/**
+ * @brief Construct a new OS Page Provider object
+ *
+ * @param HugePages ask for transparent huge pages (ignored where unsupported)
+ * @param Populate fault the whole page in when it is created
+ */
+OSPageProvider::OSPageProvider(bool HugePages, bool Populate) : huge_(HugePages), populate_(Populate)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    osPage_ = info.dwPageSize;
+#else
+    osPage_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/**
+ * @brief Maps a page straight from the OS
+ *
+ * @param Size bytes in the page, a multiple of Granularity()
+ * @return char* the page, null if the mapping failed
+ */
+char* OSPageProvider::AllocatePage(size_t Size)
+{
+#ifdef _WIN32
+    return static_cast<char*>(VirtualAlloc(nullptr, Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+    if (populate_ && !huge_)
+        flags |= MAP_POPULATE;
+#endif
+
+    //Huge pages need a 2MB aligned range, map a bit more and trim the ends
+    bool huge = huge_ && Size >= HUGE_PAGE_SIZE && Size % HUGE_PAGE_SIZE == 0;
+    size_t length = huge ? Size + HUGE_PAGE_SIZE : Size;
+    void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mapped == MAP_FAILED)
+        return nullptr;
+
+    char* page = static_cast<char*>(mapped);
+    if (huge)
+    {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(page);
+        size_t head = (HUGE_PAGE_SIZE - address % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+        if (head)
+            munmap(page, head);
+        munmap(page + head + Size, HUGE_PAGE_SIZE - head);
+        page += head;
+
+#ifdef MADV_HUGEPAGE
+        //Fails when THP is not there, the page still works with normal pages
+        madvise(page, Size, MADV_HUGEPAGE);
+#endif
+    }
+    if (huge_ && populate_)
+    {
+        //Populate after the advice so the faults can already use huge pages
+        for (size_t i = 0; i < Size; i += osPage_)
+            page[i] = 0;
+    }
+    return page;
+#endif
+}
+
+/**
+ * @brief Gives a page straight back to the OS
+ *
+ * @param Page what AllocatePage returned
+ * @param Size bytes in the page
+ */
+void OSPageProvider::ReleasePage(char* Page, size_t Size)
+{
+#ifdef _WIN32
+    (void)Size;
+    VirtualFree(Page, 0, MEM_RELEASE);
+#else
+    munmap(Page, Size);
+#endif
+}
+
+/**
+ * @brief Mappings start on an OS page
+ *
+ * @return size_t size of an OS page
+ */
+size_t OSPageProvider::Alignment(void) const
+{
+    return osPage_;
+}
+
+/**
+ * @brief The OS hands out whole pages
+ *
+ * @return size_t size of an OS page
+ */
+size_t OSPageProvider::Granularity(void) const
+{
+    return osPage_;
+}
+
+/**
+ * @brief Construct a new Guard Page Provider object
+ *
+ */
+GuardPageProvider::GuardPageProvider(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    osPage_ = info.dwPageSize;
+#else
+    osPage_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/**
+ * @brief Maps whole OS pages for the page plus one more that can't be touched,
+ *      the page is placed so its last byte is right before that one
+ *
+ * @param Size bytes in the page
+ * @return char* the page, null if the mapping failed
+ */
+char* GuardPageProvider::AllocatePage(size_t Size)
+{
+    size_t usable = (Size + osPage_ - 1) / osPage_ * osPage_;
+#ifdef _WIN32
+    char* base = static_cast<char*>(VirtualAlloc(nullptr, usable + osPage_, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!base)
+        return nullptr;
+    DWORD old;
+    if (!VirtualProtect(base + usable, osPage_, PAGE_NOACCESS, &old))
+    {
+        VirtualFree(base, 0, MEM_RELEASE);
+        return nullptr;
+    }
+#else
+    void* mapped = mmap(nullptr, usable + osPage_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+        return nullptr;
+    char* base = static_cast<char*>(mapped);
+    if (mprotect(base + usable, osPage_, PROT_NONE))
+    {
+        munmap(base, usable + osPage_);
+        return nullptr;
+    }
+#endif
+    return base + usable - Size;
+}
+
+/**
+ * @brief Unmaps a page and its guard
+ *
+ * @param Page what AllocatePage returned
+ * @param Size bytes in the page
+ */
+void GuardPageProvider::ReleasePage(char* Page, size_t Size)
+{
+    size_t usable = (Size + osPage_ - 1) / osPage_ * osPage_;
+    char* base = Page + Size - usable;
+#ifdef _WIN32
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, usable + osPage_);
+#endif
+}
+
+/**
+ * @brief Pages end on an OS page, so their start has no particular alignment
+ *
+ * @return size_t 1
+ */
+size_t GuardPageProvider::Alignment(void) const
+{
+    return 1;
+}
+
+/**
+ * @brief Construct a new Arena Page Provider object that owns its buffer
+ *
+ * @param Size bytes in the buffer
+ */
+ArenaPageProvider::ArenaPageProvider(size_t Size) :
+    buffer_(new char[Size]), size_(Size), used_(0), owned_(true), released_(nullptr)
+{
+}
+
+/**
+ * @brief Construct a new Arena Page Provider object on a buffer owned by the client
+ *
+ * @param Buffer start of the buffer
+ * @param Size bytes in the buffer
+ */
+ArenaPageProvider::ArenaPageProvider(char* Buffer, size_t Size) :
+    buffer_(Buffer), size_(Size), used_(0), owned_(false), released_(nullptr)
+{
+    //Skip the bytes before the first aligned address
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(Buffer);
+    used_ = (HEAP_ALIGNMENT - address % HEAP_ALIGNMENT) % HEAP_ALIGNMENT;
+    if (used_ > size_)
+        used_ = size_;
+}
+
+/**
+ * @brief Frees the buffer if the provider owns it
+ *
+ */
+ArenaPageProvider::~ArenaPageProvider()
+{
+    if (owned_)
+        delete[] buffer_;
+}
+
+/**
+ * @brief Reuses a released page of the same size, or carves a new one from the buffer
+ *
+ * @param Size bytes in the page
+ * @return char* the page, null if the buffer is used up
+ */
+char* ArenaPageProvider::AllocatePage(size_t Size)
+{
+    for (Released** link = &released_; *link; link = &(*link)->Next)
+    {
+        if ((*link)->Size == Size)
+        {
+            char* page = reinterpret_cast<char*>(*link);
+            *link = (*link)->Next;
+            return page;
+        }
+    }
+
+    size_t slot = ArenaSlot(Size);
+    if (slot < Size || slot > size_ - used_)
+        return nullptr;
+    char* page = buffer_ + used_;
+    used_ += slot;
+    return page;
+}
+
+/**
+ * @brief Keeps a page to hand it out again, pages at the end of what was carved go back to the buffer (never throws)
+ *      The page itself holds its node on the released list, a slot is never smaller than one.
+ *
+ * @param Page what AllocatePage returned
+ * @param Size bytes in the page
+ */
+void ArenaPageProvider::ReleasePage(char* Page, size_t Size)
+{
+    static_assert(sizeof(Released) <= HEAP_ALIGNMENT, "a released page must hold its list node");
+    size_t slot = ArenaSlot(Size);
+    if (Page + slot != buffer_ + used_)
+    {
+        Released* node = reinterpret_cast<Released*>(Page);
+        node->Next = released_;
+        node->Size = Size;
+        released_ = node;
+        return;
+    }
+    used_ -= slot;
+
+    //Released pages that are now at the end go back to the buffer too
+    for (Released** link = &released_; *link;)
+    {
+        slot = ArenaSlot((*link)->Size);
+        if (reinterpret_cast<char*>(*link) + slot == buffer_ + used_)
+        {
+            used_ -= slot;
+            *link = (*link)->Next;
+            link = &released_;
+        }
+        else
+            link = &(*link)->Next;
+    }
+}
+
+/**
+ * @brief Slots are aligned like new
+ *
+ * @return size_t alignof(std::max_align_t)
+ */
+size_t ArenaPageProvider::Alignment(void) const
+{
+    return HEAP_ALIGNMENT;
+}
+
+/**
+ * @brief Bytes in the buffer
+ *
+ * @return size_t
+ */
+size_t ArenaPageProvider::Capacity(void) const
+{
+    return size_;
+}
+
+/**
+ * @brief Bytes not carved yet, released pages are not included
+ *
+ * @return size_t
+ */
+size_t ArenaPageProvider::Available(void) const
+{
+    return size_ - used_;
+}
@@ -0,0 +1,120 @@
+//---------------------------------------------------------------------------
+#ifndef PAGEPROVIDERH
+#define PAGEPROVIDERH
+//---------------------------------------------------------------------------
+
+#include <cstddef>
+
+// Where an ObjectAllocator gets the memory for its pages. Set OAConfig::PageProvider_
+// to use one, the provider must outlive every allocator using it. Providers are not
+// thread safe, same as ObjectAllocator.
+class PageProvider
+{
+  public:
+    virtual ~PageProvider()
+    {
+    }
+
+    // Returns Size bytes starting on Alignment(), or null when out of memory (never throws)
+    virtual char * AllocatePage(size_t Size) = 0;
+
+    // Gives back a page, Size is the one it was allocated with
+    virtual void ReleasePage(char * Page, size_t Size) = 0;
+
+    // Every page starts on a multiple of this, bigger block alignments are handled by the allocator
+    virtual size_t Alignment(void) const = 0;
+
+    // Page sizes are rounded up to a multiple of this (1 = no rounding)
+    virtual size_t Granularity(void) const
+    {
+        return 1;
+    }
+};
+
+// Pages from new/delete, what ObjectAllocator uses by default
+class HeapPageProvider : public PageProvider
+{
+  public:
+    char * AllocatePage(size_t Size);
+    void   ReleasePage(char * Page, size_t Size);
+    size_t Alignment(void) const;
+
+    static HeapPageProvider & Instance(void); // shared provider for allocators that don't pick one
+};
+
+// Pages straight from the OS (mmap or VirtualAlloc), used by OAConfig::MmapPages_
+class OSPageProvider : public PageProvider
+{
+  public:
+    // HugePages asks for transparent huge pages on pages that are a multiple of 2MB,
+    // Populate faults every page in when it is created
+    OSPageProvider(bool HugePages = false, bool Populate = false);
+
+    char * AllocatePage(size_t Size);
+    void   ReleasePage(char * Page, size_t Size);
+    size_t Alignment(void) const;
+    size_t Granularity(void) const;
+
+  private:
+    bool   huge_;
+    bool   populate_;
+    size_t osPage_; // size of an OS page
+};
+
+// Pages from the OS that end right where an inaccessible (PROT_NONE) OS page starts,
+// used by OAConfig::GuardPages_. The first write past the end of a page faults at the
+// writing instruction. Each page costs a mapping and an extra OS page of address space.
+class GuardPageProvider : public PageProvider
+{
+  public:
+    GuardPageProvider(void);
+
+    char * AllocatePage(size_t Size);
+    void   ReleasePage(char * Page, size_t Size);
+    size_t Alignment(void) const; // 1, pages are placed by their end
+
+  private:
+    size_t osPage_; // size of an OS page
+};
+
+// Pages carved in order from one preallocated buffer. Released pages are kept on a
+// list written inside them and handed out again to requests of the same size, the
+// last page carved gives its bytes back to the buffer.
+class ArenaPageProvider : public PageProvider
+{
+  public:
+    // Owns a buffer of Size bytes
+    // Throws std::bad_alloc if the buffer can't be allocated
+    explicit ArenaPageProvider(size_t Size);
+
+    // Uses a buffer owned by the client, it must outlive the provider
+    ArenaPageProvider(char * Buffer, size_t Size);
+
+    // Frees the buffer if the provider owns it
+    ~ArenaPageProvider();
+
+    char * AllocatePage(size_t Size);
+    void   ReleasePage(char * Page, size_t Size);
+    size_t Alignment(void) const;
+
+    size_t Capacity(void) const;  // bytes in the buffer
+    size_t Available(void) const; // bytes not carved yet (released pages not included)
+
+  private:
+    char *                                  buffer_;
+    size_t                                  size_;
+    size_t                                  used_;     // bytes carved so far
+    bool                                    owned_;    // true if the destructor frees buffer_
+    struct Released
+    {
+        Released * Next; // next page given back
+        size_t     Size; // bytes in this one
+    };
+    Released *                              released_; // pages given back, each holds its own node so releasing never allocates
+
+    // Make private to prevent copy construction and assignment
+    ArenaPageProvider(const ArenaPageProvider & app);
+    ArenaPageProvider & operator=(const ArenaPageProvider & app);
+};
+
+#endif
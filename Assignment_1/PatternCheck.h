@@ -0,0 +1,29 @@
+//---------------------------------------------------------------------------
+#ifndef PATTERNCHECKH
+#define PATTERNCHECKH
+//---------------------------------------------------------------------------
+
+#include <cstddef>
+
+// Ways of checking that a range of bytes all hold one value (pads, signatures).
+// PatternMatches picks the fastest one the CPU supports the first time it runs.
+// Fills don't need this, memset is already vectorized by the C library.
+enum PATTERN_IMPL
+{
+    piScalar, // one byte at a time
+    piWord,   // 8 bytes at a time
+    piSSE2,   // 16 bytes at a time (x86 only)
+    piAVX2    // 32 bytes at a time (x86 only)
+};
+
+// True if the Size bytes at Block are all Pattern
+bool PatternMatches(const void * Block, size_t Size, unsigned char Pattern);
+
+// Same check with one given implementation, it must be supported
+bool PatternMatches(PATTERN_IMPL Impl, const void * Block, size_t Size, unsigned char Pattern);
+
+bool         PatternSupported(PATTERN_IMPL Impl); // true if the CPU can run Impl
+PATTERN_IMPL PatternBest(void);                   // what PatternMatches uses
+const char * PatternName(PATTERN_IMPL Impl);      // "scalar", "word", "sse2" or "avx2"
+
+#endif
@@ -0,0 +1,168 @@
+//---------------------------------------------------------------------------
+#ifndef POOLALLOCATORH
+#define POOLALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// If the client doesn't specify it:
+static const unsigned DEFAULT_POOL_OBJECTS_PER_PAGE = 4096;
+
+// Unlimited lazily carved pages of DEFAULT_POOL_OBJECTS_PER_PAGE objects, no debug checks
+inline OAConfig DefaultPoolConfig(void)
+{
+    OAConfig config(false, DEFAULT_POOL_OBJECTS_PER_PAGE, 0);
+    config.LazyPages_ = true;
+    return config;
+}
+
+// Pools shared by every PoolAllocator copied or rebound from the same one,
+// one ObjectAllocator per object size and alignment
+class PoolAllocatorState
+{
+  public:
+    explicit PoolAllocatorState(const OAConfig & config) : configuration_(config)
+    {
+    }
+
+    // Pool for objects of Size bytes aligned to Alignment (created on first use)
+    // Throws an exception if the pool can't be created. (Memory allocation problem)
+    ObjectAllocator * Pool(size_t Size, size_t Alignment)
+    {
+        // A container only uses a few node types, a linear search is enough
+        for (size_t i = 0; i < pools_.size(); i++)
+        {
+            if (pools_[i].Size == Size && pools_[i].Alignment == Alignment)
+                return pools_[i].Allocator.get();
+        }
+
+        // Blocks hold the free list link while free, and start aligned for the type
+        OAConfig config = configuration_;
+        if (Alignment > alignof(void *) && Alignment > config.Alignment_)
+            config.Alignment_ = static_cast<unsigned>(Alignment);
+
+        Entry entry;
+        entry.Size = Size;
+        entry.Alignment = Alignment;
+        entry.Allocator.reset(new ObjectAllocator(Size < sizeof(void *) ? sizeof(void *) : Size, config));
+        pools_.push_back(std::move(entry));
+        return pools_.back().Allocator.get();
+    }
+
+  private:
+    struct Entry
+    {
+        size_t                           Size;
+        size_t                           Alignment;
+        std::unique_ptr<ObjectAllocator> Allocator;
+    };
+
+    OAConfig           configuration_;
+    std::vector<Entry> pools_;
+};
+
+// Standard allocator for node based containers (list, map, set, unordered_map).
+// Single objects come from an ObjectAllocator pool sized for T, arrays (n != 1,
+// like hash table buckets) go to operator new. Rebinding shares the pools, so two
+// allocators compare equal when they were copied or rebound from the same one
+// and can free each other's memory. Not thread safe, same as ObjectAllocator.
+template <typename T>
+class PoolAllocator
+{
+  public:
+    typedef T                 value_type;
+    typedef std::true_type    propagate_on_container_copy_assignment;
+    typedef std::true_type    propagate_on_container_move_assignment;
+    typedef std::true_type    propagate_on_container_swap;
+    typedef std::false_type   is_always_equal;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef PoolAllocator<U> other;
+    };
+
+    // New set of pools with DefaultPoolConfig()
+    PoolAllocator(void) :
+        state_(std::make_shared<PoolAllocatorState>(DefaultPoolConfig())), pool_(nullptr)
+    {
+    }
+
+    // New set of pools with the given configuration
+    explicit PoolAllocator(const OAConfig & config) :
+        state_(std::make_shared<PoolAllocatorState>(config)), pool_(nullptr)
+    {
+    }
+
+    // Shares the pools of other
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> & other) noexcept : state_(other.state_), pool_(nullptr)
+    {
+    }
+
+    // Takes n objects, throws std::bad_alloc if they can't be allocated
+    T * allocate(size_t n)
+    {
+        if (n != 1)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+
+        try
+        {
+            return static_cast<T *>(Pool()->Allocate());
+        }
+        catch (const OAException &)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    // Gives back what allocate(n) returned
+    void deallocate(T * p, size_t n)
+    {
+        if (n != 1)
+            ::operator delete(p);
+        else
+            Pool()->Free(p);
+    }
+
+    // Pools of the allocator and every copy or rebind of it
+    const std::shared_ptr<PoolAllocatorState> & GetState(void) const
+    {
+        return state_;
+    }
+
+  private:
+    template <typename U>
+    friend class PoolAllocator;
+
+    std::shared_ptr<PoolAllocatorState> state_;
+    ObjectAllocator *                   pool_; // pool for T, looked up on first use
+
+    ObjectAllocator * Pool(void)
+    {
+        if (!pool_)
+            pool_ = state_->Pool(sizeof(T), alignof(T));
+        return pool_;
+    }
+};
+
+// Equal when they share the pools, so one can free what the other allocated
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> & lhs, const PoolAllocator<U> & rhs)
+{
+    return lhs.GetState() == rhs.GetState();
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> & lhs, const PoolAllocator<U> & rhs)
+{
+    return !(lhs == rhs);
+}
+
+#endif
@@ -0,0 +1,206 @@
+/**
+ * @file PoolResource.cpp
+ * @author Diego Lopez (diego.lopez@digipen.edu)
+ * @brief std::pmr::memory_resource that serves small requests from ObjectAllocator pools
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "PoolResource.h"
+
+#ifdef OA_HAS_PMR
+
+#include <new>
+
+// Pooled sizes are rounded up to this
+static const size_t SIZE_STEP = 8;
+
+// Alignments 1, 2, 4, ... up to MAX_POOLED_ALIGNMENT
+static const size_t ALIGNMENT_SLOTS = 7;
+
+/**
+ * @brief Construct a new Pool Resource object with unlimited, lazily carved pages
+ *
+ * @param MaxPooledSize biggest request served by a pool
+ * @param upstream resource for everything else
+ */
+PoolResource::PoolResource(size_t MaxPooledSize, std::pmr::memory_resource* upstream) :
+    configuration_(false, DEFAULT_RESOURCE_OBJECTS, 0), upstream_(upstream)
+{
+    configuration_.LazyPages_ = true;
+    maxSize_ = (MaxPooledSize + SIZE_STEP - 1) / SIZE_STEP * SIZE_STEP;
+    pools_.resize(ALIGNMENT_SLOTS * (maxSize_ / SIZE_STEP));
+}
+
+/**
+ * @brief Construct a new Pool Resource object
+ *
+ * @param config configuration of every pool
+ * @param MaxPooledSize biggest request served by a pool
+ * @param upstream resource for everything else
+ */
+PoolResource::PoolResource(const OAConfig& config, size_t MaxPooledSize, std::pmr::memory_resource* upstream) :
+    configuration_(config), upstream_(upstream)
+{
+    maxSize_ = (MaxPooledSize + SIZE_STEP - 1) / SIZE_STEP * SIZE_STEP;
+    pools_.resize(ALIGNMENT_SLOTS * (maxSize_ / SIZE_STEP));
+}
+
+/**
+ * @brief Frees every pool
+ *
+ */
+PoolResource::~PoolResource()
+{
+}
+
+/**
+ * @brief Frees every pool at once, memory still in use goes with them
+ *
+ */
+void PoolResource::release(void)
+{
+    for (size_t i = 0; i < pools_.size(); i++)
+        pools_[i].reset();
+}
+
+/**
+ * @brief Pool slot of a request, one per 8 bytes for each alignment
+ *
+ * @param bytes size of the request
+ * @param alignment alignment of the request, a power of two
+ * @return size_t index in pools_, pools_.size() if the request is not pooled
+ */
+size_t PoolResource::Slot(size_t bytes, size_t alignment) const
+{
+    if (bytes > maxSize_ || alignment > MAX_POOLED_ALIGNMENT)
+        return pools_.size();
+
+    size_t alignIndex = 0;
+    while ((static_cast<size_t>(1) << alignIndex) < alignment)
+        alignIndex++;
+    size_t sizeIndex = bytes ? (bytes - 1) / SIZE_STEP : 0;
+    return alignIndex * (maxSize_ / SIZE_STEP) + sizeIndex;
+}
+
+/**
+ * @brief Pool of a slot, created on first use
+ *      Throws an exception if the pool can't be created. (Memory allocation problem)
+ *
+ * @param slot index in pools_
+ * @return ObjectAllocator* the pool
+ */
+ObjectAllocator* PoolResource::Pool(size_t slot)
+{
+    if (!pools_[slot])
+    {
+        size_t count = maxSize_ / SIZE_STEP;
+        size_t size = (slot % count + 1) * SIZE_STEP;
+        size_t alignment = static_cast<size_t>(1) << (slot / count);
+
+        //Blocks are already 8 byte aligned, only ask for more than that
+        OAConfig config = configuration_;
+        if (alignment > alignof(void*) && alignment > config.Alignment_)
+            config.Alignment_ = static_cast<unsigned>(alignment);
+        pools_[slot].reset(new ObjectAllocator(size, config));
+    }
+    return pools_[slot].get();
+}
+
+/**
+ * @brief Takes a block from the pool of its size and alignment, or from upstream
+ *      Throws std::bad_alloc if the block can't be allocated
+ *
+ * @param bytes size of the request
+ * @param alignment alignment of the request
+ * @return void* the block
+ */
+void* PoolResource::do_allocate(size_t bytes, size_t alignment)
+{
+    size_t slot = Slot(bytes, alignment);
+    if (slot == pools_.size())
+        return upstream_->allocate(bytes, alignment);
+
+    try
+    {
+        return Pool(slot)->Allocate();
+    }
+    catch (const OAException&)
+    {
+        throw std::bad_alloc();
+    }
+}
+
+/**
+ * @brief Gives a block back to the pool of its size and alignment, or to upstream
+ *
+ * @param p what do_allocate returned
+ * @param bytes size it was allocated with
+ * @param alignment alignment it was allocated with
+ */
+void PoolResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    size_t slot = Slot(bytes, alignment);
+    if (slot == pools_.size())
+        upstream_->deallocate(p, bytes, alignment);
+    else
+        pools_[slot]->Free(p);
+}
+
+/**
+ * @brief Blocks can only go back to the resource they came from
+ *
+ * @param other resource to compare with
+ * @return true if other is this resource
+ */
+bool PoolResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+/**
+ * @brief Where requests that are too big or too aligned go
+ *
+ * @return std::pmr::memory_resource*
+ */
+std::pmr::memory_resource* PoolResource::upstream_resource(void) const
+{
+    return upstream_;
+}
+
+/**
+ * @brief Biggest request served by a pool
+ *
+ * @return size_t
+ */
+size_t PoolResource::GetMaxPooledSize(void) const
+{
+    return maxSize_;
+}
+
+/**
+ * @brief Statistics of every pool added up (ObjectSize_ and PageSize_ are left at 0)
+ *
+ * @return OAStats
+ */
+OAStats PoolResource::GetStats(void) const
+{
+    OAStats stats;
+    for (size_t i = 0; i < pools_.size(); i++)
+    {
+        if (!pools_[i])
+            continue;
+        OAStats pool = pools_[i]->GetStats();
+        stats.FreeObjects_ += pool.FreeObjects_;
+        stats.ObjectsInUse_ += pool.ObjectsInUse_;
+        stats.PagesInUse_ += pool.PagesInUse_;
+        stats.MostObjects_ += pool.MostObjects_;
+        stats.Allocations_ += pool.Allocations_;
+        stats.Deallocations_ += pool.Deallocations_;
+    }
+    return stats;
+}
+
+#endif
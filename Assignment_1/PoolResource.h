@@ -0,0 +1,73 @@
+//---------------------------------------------------------------------------
+#ifndef POOLRESOURCEH
+#define POOLRESOURCEH
+//---------------------------------------------------------------------------
+
+// std::pmr needs C++17 and a library that ships <memory_resource>
+#if (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#define OA_HAS_PMR 1
+#endif
+#endif
+#endif
+
+#ifdef OA_HAS_PMR
+
+#include "ObjectAllocator.h"
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// If the client doesn't specify these:
+static const size_t DEFAULT_MAX_POOLED_SIZE    = 256;
+static const unsigned DEFAULT_RESOURCE_OBJECTS = 1024;
+
+// Memory resource for std::pmr containers. Requests up to MaxPooledSize bytes,
+// aligned up to MAX_POOLED_ALIGNMENT, are rounded to 8 bytes and served by an
+// ObjectAllocator per size and alignment (created on first use). Everything
+// else goes to the upstream resource. Only equal to itself, and not thread safe,
+// same as ObjectAllocator and std::pmr::unsynchronized_pool_resource.
+class PoolResource : public std::pmr::memory_resource
+{
+  public:
+    static const size_t MAX_POOLED_ALIGNMENT = 64;
+
+    // Pools use config (MaxPages_ 0 and lazy pages unless the client says otherwise)
+    explicit PoolResource(size_t MaxPooledSize = DEFAULT_MAX_POOLED_SIZE,
+                          std::pmr::memory_resource * upstream = std::pmr::get_default_resource());
+    PoolResource(const OAConfig & config, size_t MaxPooledSize = DEFAULT_MAX_POOLED_SIZE,
+                 std::pmr::memory_resource * upstream = std::pmr::get_default_resource());
+
+    // Frees every pool (never throws), memory still in use goes with them
+    ~PoolResource();
+
+    // Frees every pool at once, like unsynchronized_pool_resource::release
+    void release(void);
+
+    std::pmr::memory_resource * upstream_resource(void) const; // where big requests go
+    size_t                      GetMaxPooledSize(void) const;  // biggest pooled request
+    OAStats                     GetStats(void) const;          // statistics of every pool added up
+
+  protected:
+    void * do_allocate(size_t bytes, size_t alignment);
+    void   do_deallocate(void * p, size_t bytes, size_t alignment);
+    bool   do_is_equal(const std::pmr::memory_resource & other) const noexcept;
+
+  private:
+    OAConfig                                      configuration_;
+    size_t                                        maxSize_;
+    std::pmr::memory_resource *                   upstream_;
+    std::vector<std::unique_ptr<ObjectAllocator>> pools_; // one slot per 8 bytes for each alignment
+
+    size_t            Slot(size_t bytes, size_t alignment) const; // index in pools_, pools_.size() if not pooled
+    ObjectAllocator * Pool(size_t slot);                          // pool of a slot (created on first use)
+
+    // Make private to prevent copy construction and assignment
+    PoolResource(const PoolResource & pr);
+    PoolResource & operator=(const PoolResource & pr);
+};
+
+#endif
+
+#endif
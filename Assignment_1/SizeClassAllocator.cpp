@@ -0,0 +1,326 @@
+/**
+ * @file SizeClassAllocator.cpp
+ * @author Diego Lopez (diego.lopez@digipen.edu)
+ * @brief Size class front end that routes many object sizes to ObjectAllocators
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "SizeClassAllocator.h"
+
+// Classes are spaced by 8 bytes up to here, then four classes per power of two
+static const size_t SMALL_CLASS_LIMIT = 64;
+static const size_t SIZE_STEP         = 8;
+
+/**
+ * @brief Construct a new Class Page Provider object
+ *
+ * @param owner allocator whose page table gets the pages
+ * @param Class class the pages belong to
+ * @param upstream provider the pages really come from
+ */
+SizeClassAllocator::ClassPageProvider::ClassPageProvider(SizeClassAllocator& owner, unsigned Class, PageProvider& upstream) :
+    owner_(owner), class_(Class), upstream_(upstream)
+{
+}
+
+/**
+ * @brief Gets a page from upstream and records it in the page table of the owner
+ *
+ * @param Size bytes in the page
+ * @return char* the page, null when upstream is out of memory
+ */
+char* SizeClassAllocator::ClassPageProvider::AllocatePage(size_t Size)
+{
+    char* page = upstream_.AllocatePage(Size);
+    if (!page)
+        return nullptr;
+
+    //Page Table insert (kept sorted so FindPage can binary search)
+    PageRange range;
+    range.Begin = page;
+    range.End = page + Size;
+    range.Class = class_;
+    std::vector<PageRange>::iterator it = owner_.pages_.begin();
+    while (it != owner_.pages_.end() && it->Begin < page)
+        ++it;
+    owner_.pages_.insert(it, range);
+    return page;
+}
+
+/**
+ * @brief Forgets a page and gives it back upstream
+ *
+ * @param Page what AllocatePage returned
+ * @param Size bytes in the page
+ */
+void SizeClassAllocator::ClassPageProvider::ReleasePage(char* Page, size_t Size)
+{
+    for (size_t i = 0; i < owner_.pages_.size(); i++)
+    {
+        if (owner_.pages_[i].Begin == Page)
+        {
+            owner_.pages_.erase(owner_.pages_.begin() + i);
+            break;
+        }
+    }
+    upstream_.ReleasePage(Page, Size);
+}
+
+/**
+ * @brief Same alignment as upstream
+ *
+ * @return size_t
+ */
+size_t SizeClassAllocator::ClassPageProvider::Alignment(void) const
+{
+    return upstream_.Alignment();
+}
+
+/**
+ * @brief Same granularity as upstream
+ *
+ * @return size_t
+ */
+size_t SizeClassAllocator::ClassPageProvider::Granularity(void) const
+{
+    return upstream_.Granularity();
+}
+
+/**
+ * @brief Construct a new Size Class Allocator object
+ *
+ * @param MaxSize biggest size served by a class, bigger ones use new
+ * @param config configuration of every class allocator
+ */
+SizeClassAllocator::SizeClassAllocator(size_t MaxSize, const OAConfig& config) :
+    configuration_(config)
+{
+    //Class sizes, the last one is the first that fits MaxSize
+    size_t size = SIZE_STEP;
+    for (;;)
+    {
+        sizes_.push_back(size);
+        if (size >= MaxSize)
+            break;
+
+        //Step is a quarter of the power of two below size, never less than 8
+        size_t step = SIZE_STEP;
+        if (size >= SMALL_CLASS_LIMIT)
+        {
+            size_t power = SMALL_CLASS_LIMIT;
+            while (power <= size / 2)
+                power *= 2;
+            step = power / 4;
+        }
+        size += step;
+    }
+    maxSize_ = sizes_.back();
+
+    //Lookup table, one entry per 8 bytes so ClassOf is a single index
+    lookup_.resize(maxSize_ / SIZE_STEP + 1);
+    unsigned current = 0;
+    for (size_t i = 0; i < lookup_.size(); i++)
+    {
+        while (sizes_[current] < i * SIZE_STEP)
+            current++;
+        lookup_[i] = static_cast<unsigned short>(current);
+    }
+
+    //Every class draws its pages through its own recording provider
+    PageProvider* upstream = configuration_.PageProvider_;
+    if (!upstream && configuration_.MmapPages_)
+    {
+        ownedProvider_.reset(new OSPageProvider(configuration_.HugePages_, configuration_.PopulatePages_));
+        upstream = ownedProvider_.get();
+    }
+    else if (!upstream)
+        upstream = &HeapPageProvider::Instance();
+    requested_.assign(sizes_.size(), 0);
+    classes_.resize(sizes_.size());
+    for (size_t i = 0; i < sizes_.size(); i++)
+        providers_.push_back(std::unique_ptr<ClassPageProvider>(new ClassPageProvider(*this, static_cast<unsigned>(i), *upstream)));
+}
+
+/**
+ * @brief Destroys every class allocator and what is left of the big objects
+ *
+ */
+SizeClassAllocator::~SizeClassAllocator()
+{
+    //Class allocators release their pages through providers_, go first
+    classes_.clear();
+    for (std::unordered_set<void*>::iterator it = big_.begin(); it != big_.end(); ++it)
+        delete[] reinterpret_cast<char*>(*it);
+}
+
+/**
+ * @brief Takes an object of at least Size bytes from its class
+ *      Throws an exception if the object can't be allocated. (Memory allocation problem)
+ *
+ * @param Size bytes the client needs
+ * @param label label for the external header of the block
+ * @return void* pointer to the allocated memory
+ */
+void* SizeClassAllocator::Allocate(size_t Size, const char* label)
+{
+    //Too big, or pages are by-passed and Free could not find the class
+    if (Size > maxSize_ || configuration_.UseCPPMemManager_)
+    {
+        char* object;
+        try {
+            object = new char[Size ? Size : 1];
+        }
+        catch (const std::exception&) { throw OAException(OAException::E_NO_MEMORY, "There is no memory, error when using new"); }
+        big_.insert(object);
+        return object;
+    }
+
+    size_t index = lookup_[(Size + SIZE_STEP - 1) / SIZE_STEP];
+    if (!classes_[index])
+    {
+        OAConfig config = configuration_;
+        config.PageProvider_ = providers_[index].get();
+        classes_[index].reset(new ObjectAllocator(sizes_[index], config));
+    }
+
+    void* object = classes_[index]->Allocate(label);
+    requested_[index] += Size;
+    return object;
+}
+
+/**
+ * @brief Returns an object to the class that owns its page
+ *      Throws an exception if the object can't be freed. (Invalid object)
+ *
+ * @param Object point in memory to free
+ */
+void SizeClassAllocator::Free(void* Object)
+{
+    const PageRange* page = FindPage(Object);
+    if (page)
+    {
+        classes_[page->Class]->Free(Object);
+        return;
+    }
+
+    std::unordered_set<void*>::iterator it = big_.find(Object);
+    if (it == big_.end())
+        throw OAException(OAException::E_BAD_BOUNDARY, "The object is not on any page of any class");
+    big_.erase(it);
+    delete[] reinterpret_cast<char*>(Object);
+}
+
+/**
+ * @brief Frees all empty pages of every class
+ *
+ * @return unsigned number of pages freed
+ */
+unsigned SizeClassAllocator::FreeEmptyPages(void)
+{
+    unsigned count = 0;
+    for (size_t i = 0; i < classes_.size(); i++)
+    {
+        if (classes_[i])
+            count += classes_[i]->FreeEmptyPages();
+    }
+    return count;
+}
+
+/**
+ * @brief Finds the page holding an object with a binary search
+ *
+ * @param Object address to look for
+ * @return const PageRange* page holding Object, or null
+ */
+const SizeClassAllocator::PageRange* SizeClassAllocator::FindPage(const void* Object) const
+{
+    const char* address = static_cast<const char*>(Object);
+    size_t low = 0;
+    size_t high = pages_.size();
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (pages_[middle].Begin <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0 || address >= pages_[low - 1].End)
+        return nullptr;
+    return &pages_[low - 1];
+}
+
+/**
+ * @brief Number of size classes
+ *
+ * @return size_t
+ */
+size_t SizeClassAllocator::ClassCount(void) const
+{
+    return sizes_.size();
+}
+
+/**
+ * @brief Object size of a class
+ *      Throws an exception if there is no such class. (Bad boundary)
+ *
+ * @param Class index of the class
+ * @return size_t
+ */
+size_t SizeClassAllocator::ClassSize(size_t Class) const
+{
+    if (Class >= sizes_.size())
+        throw OAException(OAException::E_BAD_BOUNDARY, "There is no size class with that index");
+    return sizes_[Class];
+}
+
+/**
+ * @brief Class serving a size
+ *
+ * @param Size bytes the client needs
+ * @return size_t index of the class, ClassCount() if Size is above the limit
+ */
+size_t SizeClassAllocator::ClassOf(size_t Size) const
+{
+    if (Size > maxSize_)
+        return sizes_.size();
+    return lookup_[(Size + SIZE_STEP - 1) / SIZE_STEP];
+}
+
+/**
+ * @brief Biggest size served by a class
+ *
+ * @return size_t
+ */
+size_t SizeClassAllocator::GetMaxSize(void) const
+{
+    return maxSize_;
+}
+
+/**
+ * @brief Statistics of a class and its internal fragmentation over every allocation
+ *      Throws an exception if there is no such class. (Bad boundary)
+ *
+ * @param Class index of the class
+ * @return SizeClassStats
+ */
+SizeClassStats SizeClassAllocator::GetClassStats(size_t Class) const
+{
+    if (Class >= sizes_.size())
+        throw OAException(OAException::E_BAD_BOUNDARY, "There is no size class with that index");
+
+    SizeClassStats stats;
+    stats.ClassSize_ = sizes_[Class];
+    stats.RequestedBytes_ = requested_[Class];
+    if (classes_[Class])
+        stats.Stats_ = classes_[Class]->GetStats();
+
+    unsigned long long handed = static_cast<unsigned long long>(stats.Stats_.Allocations_) * stats.ClassSize_;
+    stats.WastedBytes_ = handed - stats.RequestedBytes_;
+    if (handed)
+        stats.Fragmentation_ = static_cast<double>(stats.WastedBytes_) / static_cast<double>(handed);
+    return stats;
+}
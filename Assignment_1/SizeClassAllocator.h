@@ -0,0 +1,103 @@
+//---------------------------------------------------------------------------
+#ifndef SIZECLASSALLOCATORH
+#define SIZECLASSALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+// If the client doesn't specify it:
+static const size_t DEFAULT_MAX_CLASS_SIZE = 1024;
+
+// Statistics of one size class
+struct SizeClassStats
+{
+    SizeClassStats(void) : ClassSize_(0), RequestedBytes_(0), WastedBytes_(0), Fragmentation_(0) {};
+
+    size_t             ClassSize_;      // size of every object of the class
+    OAStats            Stats_;          // statistics of the class allocator (empty if never used)
+    unsigned long long RequestedBytes_; // bytes the client asked for over every allocation
+    unsigned long long WastedBytes_;    // bytes handed out past what was asked for (internal fragmentation)
+    double             Fragmentation_;  // WastedBytes_ over the bytes handed out, 0 to 1
+};
+
+// Front end for many object sizes. Sizes up to MaxSize are rounded up to a size
+// class, jemalloc style: 8 byte steps up to 64 and then four classes for every
+// power of two (80, 96, 112, 128, 160, ...). Every class is an ObjectAllocator
+// created on first use with the same config. Bigger sizes go to new/delete.
+//
+// Free finds the class from the page the object is on, every class draws its
+// pages through a provider that records them, so no size is needed.
+class SizeClassAllocator
+{
+  public:
+    // Builds the classes up to MaxSize, class allocators are created on first use
+    SizeClassAllocator(size_t MaxSize, const OAConfig & config);
+
+    // Destroys every class allocator and what is left of the big objects (never throws)
+    ~SizeClassAllocator();
+
+    // Takes an object of at least Size bytes from its class (new for sizes above the limit)
+    // Throws an exception if the object can't be allocated. (Memory allocation problem)
+    void * Allocate(size_t Size, const char * label = 0);
+
+    // Returns an object to the class it came from
+    // Throws an exception if the object can't be freed. (Invalid object)
+    void Free(void * Object);
+
+    // Frees all empty pages of every class
+    unsigned FreeEmptyPages(void);
+
+    // ClassSize and GetClassStats throw E_BAD_BOUNDARY for a class past ClassCount() - 1
+    size_t         ClassCount(void) const;            // number of size classes
+    size_t         ClassSize(size_t Class) const;     // object size of a class
+    size_t         ClassOf(size_t Size) const;        // class serving Size, ClassCount() if too big
+    size_t         GetMaxSize(void) const;            // biggest size served by a class
+    SizeClassStats GetClassStats(size_t Class) const; // statistics and fragmentation of a class
+
+  private:
+    // Provider for one class, records every page it hands out in pages_
+    class ClassPageProvider : public PageProvider
+    {
+      public:
+        ClassPageProvider(SizeClassAllocator & owner, unsigned Class, PageProvider & upstream);
+        char * AllocatePage(size_t Size);
+        void   ReleasePage(char * Page, size_t Size);
+        size_t Alignment(void) const;
+        size_t Granularity(void) const;
+
+      private:
+        SizeClassAllocator & owner_;
+        unsigned             class_;
+        PageProvider &       upstream_;
+    };
+
+    // Memory range of a page and the class that owns it
+    struct PageRange
+    {
+        char *   Begin;
+        char *   End;
+        unsigned Class;
+    };
+
+    OAConfig                                        configuration_; // config of every class allocator
+    size_t                                          maxSize_;
+    std::vector<size_t>                             sizes_;         // object size of each class
+    std::vector<unsigned short>                     lookup_;        // class of each 8 byte step up to maxSize_
+    std::vector<unsigned long long>                 requested_;     // bytes asked for per class
+    std::vector<PageRange>                          pages_;         // every page of every class, sorted by address
+    std::unique_ptr<PageProvider>                   ownedProvider_; // upstream created for MmapPages_, null otherwise
+    std::vector<std::unique_ptr<ClassPageProvider>> providers_;     // one per class
+    std::vector<std::unique_ptr<ObjectAllocator>>   classes_;       // null until the class is used
+    std::unordered_set<void *>                      big_;           // objects above the limit, from new
+
+    const PageRange * FindPage(const void * Object) const; // page holding Object, or null
+
+    // Make private to prevent copy construction and assignment
+    SizeClassAllocator(const SizeClassAllocator & sca);
+    SizeClassAllocator & operator=(const SizeClassAllocator & sca);
+};
+
+#endif
@@ -0,0 +1,816 @@
+/**
+ * @file benchmark.cpp
+ * @author Diego Lopez (diego.lopez@digipen.edu)
+ * @brief Timing of ObjectAllocator on standard allocation patterns, prints JSON
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Usage: benchmark [--mode patterns|overhead|pads|batch] [--objects N] [--reps N] [--quick]
+ *
+ * patterns: every run allocates and frees N objects following one pattern and reports the
+ * best of --reps runs in ns per operation (an Allocate or a Free) and millions of
+ * operations per second. Patterns are LIFO, FIFO, random order, a sliding window
+ * and producer/consumer bursts. They are swept across object sizes, ObjectsPerPage_
+ * values and every debug/pad/header configuration, plus new/delete
+ * (UseCPPMemManager_) and malloc as baselines. The random sequences come from a
+ * fixed seed so two runs replay the same operations.
+ *
+ * overhead: one recorded trace of allocation and free bursts is replayed on every
+ * combination of DebugOn_, PadBytes_ and header kind. It reports the ns per Allocate
+ * and per Free added over the plain configuration, the page size inflation, the
+ * cost of ValidatePages on the live heap, and which bug classes (double free, bad
+ * pointer, overflow) each configuration actually catches.
+ *
+ * pads: ns per check of an intact pad of each size with every pattern check the
+ * CPU supports (scalar, word, SSE2, AVX2), and the speedup over the scalar loop.
+ *
+ * batch: N objects allocated with AllocateBatch and freed with FreeBatch in batches
+ * of 1 to 4096, in ns per object, against the same N with Allocate and Free one by one.
+ * The warm allocation runs again after the frees, when only the free list is left to pop.
+ */
+#include "ObjectAllocator.h"
+#include "PRNG.h"
+#include "PatternCheck.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+// Object sizes, pages and configurations of the sweep
+const size_t   SIZES[] = {16, 64, 256};
+const unsigned PAGES[] = {64, 1024, 4096};
+const unsigned PAD_BYTES = 8;
+const OAConfig::HBLOCK_TYPE HEADERS[] = {OAConfig::hbNone, OAConfig::hbBasic, OAConfig::hbExtended, OAConfig::hbExternal};
+const unsigned EXTENDED_BYTES = 4; // user-defined bytes of hbExtended
+
+const char * HeaderName(OAConfig::HBLOCK_TYPE type)
+{
+    switch (type)
+    {
+        case OAConfig::hbBasic:
+            return "basic";
+        case OAConfig::hbExtended:
+            return "extended";
+        case OAConfig::hbExternal:
+            return "external";
+        default:
+            return "none";
+    }
+}
+
+// What a pattern allocates from
+class Backend
+{
+  public:
+    virtual ~Backend()
+    {
+    }
+    virtual void * Allocate(void) = 0;
+    virtual void   Free(void * Object) = 0;
+};
+
+class OABackend : public Backend
+{
+  public:
+    OABackend(size_t ObjectSize, const OAConfig & config) : oa_(ObjectSize, config)
+    {
+    }
+    void * Allocate(void)
+    {
+        return oa_.Allocate();
+    }
+    void Free(void * Object)
+    {
+        oa_.Free(Object);
+    }
+
+  private:
+    ObjectAllocator oa_;
+};
+
+class MallocBackend : public Backend
+{
+  public:
+    explicit MallocBackend(size_t ObjectSize) : size_(ObjectSize)
+    {
+    }
+    void * Allocate(void)
+    {
+        void * p = std::malloc(size_);
+        if (!p)
+            throw OAException(OAException::E_NO_MEMORY, "malloc failed");
+        return p;
+    }
+    void Free(void * Object)
+    {
+        std::free(Object);
+    }
+
+  private:
+    size_t size_;
+};
+
+// Fixed seed so every run, and every backend, sees the same sequence
+void Reseed(void)
+{
+    Digipen::Utils::srand(521288629, 362436069);
+}
+
+// Block indices in random order
+void Shuffle(std::vector<size_t> & order)
+{
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    for (size_t i = 0; i + 1 < order.size(); i++)
+    {
+        size_t r = static_cast<size_t>(Digipen::Utils::Random(static_cast<int>(i), static_cast<int>(order.size()) - 1));
+        std::swap(order[i], order[r]);
+    }
+}
+
+// Touches the first word of a block so the allocation isn't optimized away
+inline void Touch(void * block, size_t i)
+{
+    *static_cast<size_t *>(block) = i;
+}
+
+// Allocate all, free newest first. Returns the number of operations
+size_t Lifo(Backend & backend, std::vector<void *> & blocks, const std::vector<size_t> &)
+{
+    for (size_t i = 0; i < blocks.size(); i++)
+        Touch(blocks[i] = backend.Allocate(), i);
+    for (size_t i = blocks.size(); i-- > 0;)
+        backend.Free(blocks[i]);
+    return 2 * blocks.size();
+}
+
+// Allocate all, free oldest first
+size_t Fifo(Backend & backend, std::vector<void *> & blocks, const std::vector<size_t> &)
+{
+    for (size_t i = 0; i < blocks.size(); i++)
+        Touch(blocks[i] = backend.Allocate(), i);
+    for (size_t i = 0; i < blocks.size(); i++)
+        backend.Free(blocks[i]);
+    return 2 * blocks.size();
+}
+
+// Allocate all, free in the random order Measure shuffled before the timer started
+size_t RandomOrder(Backend & backend, std::vector<void *> & blocks, const std::vector<size_t> & order)
+{
+    for (size_t i = 0; i < blocks.size(); i++)
+        Touch(blocks[i] = backend.Allocate(), i);
+    for (size_t i = 0; i < blocks.size(); i++)
+        backend.Free(blocks[order[i]]);
+    return 2 * blocks.size();
+}
+
+// Keeps the last Window objects alive, every new one frees the oldest
+size_t SlidingWindow(Backend & backend, std::vector<void *> & blocks, const std::vector<size_t> &)
+{
+    size_t window = blocks.size() / 16 + 1;
+    std::vector<void *> ring(window, nullptr);
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        void *& slot = ring[i % window];
+        if (slot)
+            backend.Free(slot);
+        Touch(slot = backend.Allocate(), i);
+    }
+    for (size_t i = 0; i < window; i++)
+    {
+        if (ring[i])
+            backend.Free(ring[i]);
+    }
+    return 2 * blocks.size();
+}
+
+// A producer makes bursts of random size that a consumer drains in order, in random sized bites
+size_t ProducerConsumer(Backend & backend, std::vector<void *> & blocks, const std::vector<size_t> &)
+{
+    size_t head = 0; // next one to consume
+    size_t tail = 0; // next one to produce
+    size_t count = blocks.size();
+    while (head < count)
+    {
+        size_t produce = static_cast<size_t>(Digipen::Utils::Random(1, 64));
+        for (size_t i = 0; i < produce && tail < count; i++, tail++)
+            Touch(blocks[tail] = backend.Allocate(), tail);
+        size_t consume = static_cast<size_t>(Digipen::Utils::Random(1, 64));
+        if (tail == count)
+            consume = count - head;
+        for (size_t i = 0; i < consume && head < tail; i++, head++)
+            backend.Free(blocks[head]);
+    }
+    return 2 * count;
+}
+
+struct Pattern
+{
+    const char * Name;
+    size_t (*Run)(Backend &, std::vector<void *> &, const std::vector<size_t> &);
+    bool Shuffled; // Run gets the blocks in random order, shuffled before the timer starts
+};
+
+const Pattern PATTERNS[] = {{"lifo", Lifo, false},
+                            {"fifo", Fifo, false},
+                            {"random", RandomOrder, true},
+                            {"sliding_window", SlidingWindow, false},
+                            {"producer_consumer", ProducerConsumer, false}};
+
+// One line of the JSON output
+struct Result
+{
+    std::string Pattern;
+    std::string Allocator; // ObjectAllocator, new_delete or malloc
+    size_t      ObjectSize;
+    unsigned    ObjectsPerPage;
+    bool        DebugOn;
+    unsigned    PadBytes;
+    std::string Header;
+    size_t      PageSize;
+    double      NsPerOp;
+    double      MopsPerSec;
+    std::string Error;
+};
+
+// Best of reps runs of one pattern, a new backend for every run
+template <typename Make>
+void Measure(const Pattern & pattern, Make make, size_t objects, unsigned reps, Result & result)
+{
+    std::vector<void *> blocks(objects);
+    double best = 0;
+
+    // Same order for every run and every backend, and not timed
+    std::vector<size_t> order;
+    if (pattern.Shuffled)
+    {
+        Reseed();
+        order.resize(objects);
+        Shuffle(order);
+    }
+    try
+    {
+        for (unsigned r = 0; r < reps; r++)
+        {
+            Reseed();
+            std::unique_ptr<Backend> backend(make());
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            size_t ops = pattern.Run(*backend, blocks, order);
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ops;
+            if (r == 0 || ns < best)
+                best = ns;
+        }
+    }
+    catch (const OAException & e)
+    {
+        result.Error = e.what();
+    }
+    result.NsPerOp = best;
+    result.MopsPerSec = best > 0 ? 1000.0 / best : 0;
+}
+
+void PrintResult(const Result & r, bool last)
+{
+    std::printf("    {\"pattern\": \"%s\", \"allocator\": \"%s\", \"object_size\": %u, \"objects_per_page\": %u, "
+                "\"debug\": %s, \"pad_bytes\": %u, \"header\": \"%s\", \"page_size\": %u, "
+                "\"ns_per_op\": %.3f, \"mops_per_sec\": %.3f",
+                r.Pattern.c_str(), r.Allocator.c_str(), static_cast<unsigned>(r.ObjectSize), r.ObjectsPerPage,
+                r.DebugOn ? "true" : "false", r.PadBytes, r.Header.c_str(), static_cast<unsigned>(r.PageSize),
+                r.NsPerOp, r.MopsPerSec);
+    if (!r.Error.empty())
+        std::printf(", \"error\": \"%s\"", r.Error.c_str());
+    std::printf("}%s\n", last ? "" : ",");
+}
+
+struct MakeOA
+{
+    size_t   Size;
+    OAConfig Config;
+    Backend * operator()(void) const
+    {
+        return new OABackend(Size, Config);
+    }
+};
+
+struct MakeMalloc
+{
+    size_t Size;
+    Backend * operator()(void) const
+    {
+        return new MallocBackend(Size);
+    }
+};
+
+// Every pattern across sizes, pages and configurations, plus the baselines
+void RunPatterns(size_t objects, unsigned reps, bool quick, std::vector<Result> & results)
+{
+    size_t sizes = quick ? 1 : sizeof(SIZES) / sizeof(*SIZES);
+    size_t pages = quick ? 1 : sizeof(PAGES) / sizeof(*PAGES);
+    for (size_t p = 0; p < sizeof(PATTERNS) / sizeof(*PATTERNS); p++)
+    {
+        for (size_t s = 0; s < sizes; s++)
+        {
+            Result base;
+            base.Pattern = PATTERNS[p].Name;
+            base.ObjectSize = SIZES[s];
+            base.ObjectsPerPage = 0;
+            base.DebugOn = false;
+            base.PadBytes = 0;
+            base.Header = "none";
+            base.PageSize = 0;
+
+            // Baselines
+            Result r = base;
+            r.Allocator = "new_delete";
+            MakeOA newdel = {SIZES[s], OAConfig(true, PAGES[0], 0)};
+            Measure(PATTERNS[p], newdel, objects, reps, r);
+            results.push_back(r);
+
+            r = base;
+            r.Allocator = "malloc";
+            MakeMalloc mall = {SIZES[s]};
+            Measure(PATTERNS[p], mall, objects, reps, r);
+            results.push_back(r);
+
+            // ObjectAllocator with every debug/pad/header combination
+            for (size_t g = 0; g < pages; g++)
+            {
+                for (int debug = 0; debug < 2; debug++)
+                {
+                    for (int pad = 0; pad < 2; pad++)
+                    {
+                        for (size_t h = 0; h < sizeof(HEADERS) / sizeof(*HEADERS); h++)
+                        {
+                            OAConfig::HeaderBlockInfo header(HEADERS[h], HEADERS[h] == OAConfig::hbExtended ? EXTENDED_BYTES : 0);
+                            MakeOA make = {SIZES[s], OAConfig(false, PAGES[g], 0, debug != 0, pad ? PAD_BYTES : 0, header)};
+
+                            r = base;
+                            r.Allocator = "ObjectAllocator";
+                            r.ObjectsPerPage = PAGES[g];
+                            r.DebugOn = debug != 0;
+                            r.PadBytes = pad ? PAD_BYTES : 0;
+                            r.Header = HeaderName(HEADERS[h]);
+                            r.PageSize = ObjectAllocator(SIZES[s], make.Config).GetStats().PageSize_;
+                            Measure(PATTERNS[p], make, objects, reps, r);
+                            results.push_back(r);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Pads of the overhead sweep
+const unsigned OVERHEAD_PADS[] = {0, 8, 64};
+
+// One burst of the replayed trace: Count allocations, or Count frees of the given live slots
+struct Burst
+{
+    bool                Allocate;
+    std::vector<size_t> Victims; // slots of the live array freed, in order (frees only)
+    size_t              Count;
+};
+
+// Allocation and free bursts that grow the heap to about objects live blocks and
+// churn it, the same trace for every configuration
+std::vector<Burst> RecordTrace(size_t objects)
+{
+    Reseed();
+    std::vector<Burst> trace;
+    size_t live = 0;
+    size_t total = 0;
+    while (total < 8 * objects)
+    {
+        Burst burst;
+        burst.Allocate = live < objects / 2 || (live < objects && Digipen::Utils::Random(0, 1));
+        burst.Count = static_cast<size_t>(Digipen::Utils::Random(16, 256));
+        if (burst.Allocate)
+            live += burst.Count;
+        else
+        {
+            if (burst.Count > live)
+                burst.Count = live;
+            for (size_t i = 0; i < burst.Count; i++, live--)
+                burst.Victims.push_back(static_cast<size_t>(Digipen::Utils::Random(0, static_cast<int>(live) - 1)));
+        }
+        total += burst.Count;
+        trace.push_back(burst);
+    }
+    return trace;
+}
+
+struct Overhead
+{
+    bool        DebugOn = false;
+    unsigned    PadBytes = 0;
+    std::string Header;
+    size_t      PageSize = 0;
+    double      AllocNs = 0;        // ns per Allocate
+    double      FreeNs = 0;         // ns per Free
+    double      ValidateNs = 0;     // ns per ValidatePages call on the live heap of the end of the trace
+    unsigned    ValidateBlocks = 0; // blocks on the pages ValidatePages scanned
+    bool        DoubleFree = false; // Free of a freed block throws
+    bool        BadPointer = false; // Free of an address inside a block throws
+    bool        Overflow = false;   // Free of a block written one byte past its end throws
+    std::string Error;
+};
+
+void IgnoreCorruption(const void *, size_t)
+{
+}
+
+// Replays the trace on a new allocator, adds up the time of every allocation and free burst
+void Replay(const std::vector<Burst> & trace, size_t ObjectSize, const OAConfig & config, Overhead & result)
+{
+    ObjectAllocator oa(ObjectSize, config);
+    std::vector<void *> live;
+    live.reserve(trace.size() * 256);
+    double allocNs = 0;
+    double freeNs = 0;
+    size_t allocs = 0;
+    size_t frees = 0;
+    for (size_t b = 0; b < trace.size(); b++)
+    {
+        const Burst & burst = trace[b];
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (burst.Allocate)
+        {
+            for (size_t i = 0; i < burst.Count; i++)
+                live.push_back(oa.Allocate());
+            allocNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            allocs += burst.Count;
+        }
+        else
+        {
+            // swap-remove keeps the victim slots valid for the trace
+            for (size_t i = 0; i < burst.Count; i++)
+            {
+                void *& slot = live[burst.Victims[i]];
+                oa.Free(slot);
+                slot = live.back();
+                live.pop_back();
+            }
+            freeNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            frees += burst.Count;
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    oa.ValidatePages(IgnoreCorruption);
+    double validateNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    if (result.AllocNs == 0 || allocNs / allocs < result.AllocNs)
+        result.AllocNs = allocNs / allocs;
+    if (result.FreeNs == 0 || freeNs / frees < result.FreeNs)
+        result.FreeNs = freeNs / frees;
+    if (result.ValidateNs == 0 || validateNs < result.ValidateNs)
+        result.ValidateNs = validateNs;
+    result.ValidateBlocks = oa.GetStats().PagesInUse_ * config.ObjectsPerPage_;
+    result.PageSize = oa.GetStats().PageSize_;
+}
+
+// Tries one bug on a throwaway allocator, true if Free threw. Without DebugOn_ Free
+// checks nothing and the bug would just corrupt the allocator, so it isn't tried
+bool Catches(size_t ObjectSize, const OAConfig & config, int bug)
+{
+    if (!config.DebugOn_)
+        return false;
+
+    OAConfig probe = config;
+    probe.ObjectsPerPage_ = 4;
+    probe.MaxPages_ = 1;
+    ObjectAllocator oa(ObjectSize, probe);
+    char * a = static_cast<char *>(oa.Allocate());
+    char * b = static_cast<char *>(oa.Allocate());
+    char * low = a < b ? a : b; // another block follows it on the page
+    try
+    {
+        if (bug == 0)
+        {
+            oa.Free(low);
+            oa.Free(low);
+        }
+        else if (bug == 1)
+            oa.Free(low + sizeof(void *));
+        else
+        {
+            low[ObjectSize] = 0;
+            oa.Free(low);
+        }
+    }
+    catch (const OAException &)
+    {
+        return true;
+    }
+    return false;
+}
+
+// Cross product of DebugOn_, PadBytes_ and header kinds on one replayed trace
+void RunOverhead(size_t objects, unsigned reps, bool quick, std::vector<Overhead> & results)
+{
+    const size_t size = SIZES[1];
+    std::vector<Burst> trace = RecordTrace(quick ? objects / 4 + 1 : objects);
+    for (int debug = 0; debug < 2; debug++)
+    {
+        for (size_t pad = 0; pad < sizeof(OVERHEAD_PADS) / sizeof(*OVERHEAD_PADS); pad++)
+        {
+            for (size_t h = 0; h < sizeof(HEADERS) / sizeof(*HEADERS); h++)
+            {
+                OAConfig::HeaderBlockInfo header(HEADERS[h], HEADERS[h] == OAConfig::hbExtended ? EXTENDED_BYTES : 0);
+                OAConfig config(false, PAGES[1], 0, debug != 0, OVERHEAD_PADS[pad], header);
+
+                Overhead r;
+                r.DebugOn = debug != 0;
+                r.PadBytes = OVERHEAD_PADS[pad];
+                r.Header = HeaderName(HEADERS[h]);
+                try
+                {
+                    for (unsigned i = 0; i < reps; i++)
+                        Replay(trace, size, config, r);
+                    r.DoubleFree = Catches(size, config, 0);
+                    r.BadPointer = Catches(size, config, 1);
+                    r.Overflow = Catches(size, config, 2);
+                }
+                catch (const OAException & e)
+                {
+                    r.Error = e.what();
+                }
+                results.push_back(r);
+            }
+        }
+    }
+}
+
+void PrintOverhead(const Overhead & r, const Overhead & base, bool last)
+{
+    std::printf("    {\"debug\": %s, \"pad_bytes\": %u, \"header\": \"%s\", \"page_size\": %u, \"page_inflation\": %.3f, "
+                "\"alloc_ns\": %.3f, \"free_ns\": %.3f, \"added_alloc_ns\": %.3f, \"added_free_ns\": %.3f, "
+                "\"validate_ns\": %.0f, \"validate_blocks\": %u, "
+                "\"catches\": {\"double_free\": %s, \"bad_pointer\": %s, \"overflow\": %s}",
+                r.DebugOn ? "true" : "false", r.PadBytes, r.Header.c_str(), static_cast<unsigned>(r.PageSize),
+                base.PageSize ? static_cast<double>(r.PageSize) / base.PageSize : 0, r.AllocNs, r.FreeNs,
+                r.AllocNs - base.AllocNs, r.FreeNs - base.FreeNs, r.ValidateNs, r.ValidateBlocks,
+                r.DoubleFree ? "true" : "false", r.BadPointer ? "true" : "false", r.Overflow ? "true" : "false");
+    if (!r.Error.empty())
+        std::printf(", \"error\": \"%s\"", r.Error.c_str());
+    std::printf("}%s\n", last ? "" : ",");
+}
+
+// Pad sizes of the pattern check microbenchmark
+const size_t PAD_SIZES[] = {4, 8, 16, 32, 64, 128, 256, 1024, 4096};
+
+struct PadCheck
+{
+    size_t       PadBytes;
+    PATTERN_IMPL Impl;
+    double       Ns;      // ns per check
+    double       Speedup; // scalar ns / Ns
+};
+
+// Best of reps timings of checking an intact pad of every size with every supported implementation
+void RunPads(unsigned reps, bool quick, std::vector<PadCheck> & results)
+{
+    const size_t bytesPerRun = quick ? (1 << 20) : (1 << 24);
+    const unsigned char pattern = ObjectAllocator::PAD_PATTERN;
+    std::vector<unsigned char> pad(PAD_SIZES[sizeof(PAD_SIZES) / sizeof(*PAD_SIZES) - 1] + 1, pattern);
+    const PATTERN_IMPL impls[] = {piScalar, piWord, piSSE2, piAVX2};
+    for (size_t s = 0; s < sizeof(PAD_SIZES) / sizeof(*PAD_SIZES); s++)
+    {
+        size_t size = PAD_SIZES[s];
+        size_t checks = bytesPerRun / size;
+        double scalar = 0;
+        for (size_t k = 0; k < sizeof(impls) / sizeof(*impls); k++)
+        {
+            if (!PatternSupported(impls[k]))
+                continue;
+            double best = 0;
+            for (unsigned r = 0; r < reps; r++)
+            {
+                // odd offsets so the pads aren't aligned, like the ones after an object
+                volatile unsigned matched = 0;
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < checks; i++)
+                    matched += PatternMatches(impls[k], &pad[i & 1], size, pattern);
+                double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / checks;
+                if (matched != checks)
+                    std::fprintf(stderr, "%s check failed on an intact pad\n", PatternName(impls[k]));
+                if (r == 0 || ns < best)
+                    best = ns;
+            }
+            if (impls[k] == piScalar)
+                scalar = best;
+
+            PadCheck result;
+            result.PadBytes = size;
+            result.Impl = impls[k];
+            result.Ns = best;
+            result.Speedup = best > 0 ? scalar / best : 0;
+            results.push_back(result);
+        }
+    }
+}
+
+void PrintPadCheck(const PadCheck & r, bool last)
+{
+    std::printf("    {\"pad_bytes\": %u, \"impl\": \"%s\", \"ns_per_check\": %.3f, \"speedup\": %.2f}%s\n",
+                static_cast<unsigned>(r.PadBytes), PatternName(r.Impl), r.Ns, r.Speedup, last ? "" : ",");
+}
+
+// Batch sizes of the batch sweep (--quick only runs every third one)
+const size_t BATCH_SIZES[] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+struct Batch
+{
+    size_t Size;          // objects per AllocateBatch/FreeBatch call, 0 = Allocate/Free one by one
+    double AllocNs;       // ns per object allocated
+    double FreeNs;        // ns per object freed
+    double WarmNs;        // ns per object allocated again once the pages exist (free list work only)
+    std::string Error;
+};
+
+// Allocates objects in batches of Size (one by one for 0)
+void AllocateBatches(ObjectAllocator & oa, size_t objects, size_t size, std::vector<void *> & blocks)
+{
+    if (!size)
+    {
+        for (size_t i = 0; i < objects; i++)
+            blocks[i] = oa.Allocate();
+    }
+    else
+    {
+        for (size_t i = 0; i < objects; i += size)
+            oa.AllocateBatch(size < objects - i ? size : objects - i, &blocks[i]);
+    }
+}
+
+// Best of reps timings of allocating and freeing objects in batches of Size, a new allocator every run.
+// The first allocation pays for creating the pages, the warm one after the frees only pops free lists
+void MeasureBatch(size_t objects, unsigned reps, Batch & result)
+{
+    std::vector<void *> blocks(objects);
+    result.AllocNs = 0;
+    result.FreeNs = 0;
+    result.WarmNs = 0;
+    try
+    {
+        for (unsigned r = 0; r < reps; r++)
+        {
+            ObjectAllocator oa(SIZES[1], OAConfig(false, PAGES[1], 0));
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            AllocateBatches(oa, objects, result.Size, blocks);
+            std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+            if (!result.Size)
+            {
+                for (size_t i = 0; i < objects; i++)
+                    oa.Free(blocks[i]);
+            }
+            else
+            {
+                for (size_t i = 0; i < objects; i += result.Size)
+                    oa.FreeBatch(&blocks[i], result.Size < objects - i ? result.Size : objects - i);
+            }
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            AllocateBatches(oa, objects, result.Size, blocks);
+            std::chrono::steady_clock::time_point warm = std::chrono::steady_clock::now();
+
+            double alloc = std::chrono::duration<double, std::nano>(middle - start).count() / objects;
+            double freed = std::chrono::duration<double, std::nano>(end - middle).count() / objects;
+            if (r == 0 || alloc < result.AllocNs)
+                result.AllocNs = alloc;
+            if (r == 0 || freed < result.FreeNs)
+                result.FreeNs = freed;
+            double again = std::chrono::duration<double, std::nano>(warm - end).count() / objects;
+            if (r == 0 || again < result.WarmNs)
+                result.WarmNs = again;
+        }
+    }
+    catch (const OAException & e)
+    {
+        result.Error = e.what();
+    }
+}
+
+// One by one first, it is what every batch size is compared to
+void RunBatches(size_t objects, unsigned reps, bool quick, std::vector<Batch> & results)
+{
+    Batch single;
+    single.Size = 0;
+    MeasureBatch(objects, reps, single);
+    results.push_back(single);
+    for (size_t i = 0; i < sizeof(BATCH_SIZES) / sizeof(*BATCH_SIZES); i += quick ? 3 : 1)
+    {
+        Batch batch;
+        batch.Size = BATCH_SIZES[i];
+        MeasureBatch(objects, reps, batch);
+        results.push_back(batch);
+    }
+}
+
+void PrintBatch(const Batch & r, const Batch & single, bool last)
+{
+    std::printf("    {\"batch\": %u, \"alloc_ns_per_object\": %.3f, \"free_ns_per_object\": %.3f, "
+                "\"warm_alloc_ns_per_object\": %.3f, \"alloc_speedup\": %.2f, \"free_speedup\": %.2f, "
+                "\"warm_alloc_speedup\": %.2f",
+                static_cast<unsigned>(r.Size), r.AllocNs, r.FreeNs, r.WarmNs, r.AllocNs > 0 ? single.AllocNs / r.AllocNs : 0,
+                r.FreeNs > 0 ? single.FreeNs / r.FreeNs : 0, r.WarmNs > 0 ? single.WarmNs / r.WarmNs : 0);
+    if (!r.Error.empty())
+        std::printf(", \"error\": \"%s\"", r.Error.c_str());
+    std::printf("}%s\n", last ? "" : ",");
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    size_t      objects = 100000;
+    unsigned    reps    = 3;
+    bool        quick   = false;
+    std::string mode    = "patterns";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!std::strcmp(argv[i], "--mode") && i + 1 < argc)
+            mode = argv[++i];
+        else if (!std::strcmp(argv[i], "--objects") && i + 1 < argc)
+            objects = static_cast<size_t>(std::atol(argv[++i]));
+        else if (!std::strcmp(argv[i], "--reps") && i + 1 < argc)
+            reps = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--quick"))
+            quick = true;
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--mode patterns|overhead|pads|batch] [--objects N] [--reps N] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!objects || !reps)
+    {
+        std::fprintf(stderr, "--objects and --reps must be positive\n");
+        return 1;
+    }
+
+    if (mode == "overhead")
+    {
+        std::vector<Overhead> results;
+        RunOverhead(objects, reps, quick, results);
+
+        // The first configuration (no debug, no pads, no header) is the one the others are compared to
+        std::printf("{\n  \"benchmark\": \"overhead\",\n  \"objects\": %u,\n  \"reps\": %u,\n  \"object_size\": %u,\n  \"results\": [\n",
+                    static_cast<unsigned>(objects), reps, static_cast<unsigned>(SIZES[1]));
+        for (size_t i = 0; i < results.size(); i++)
+            PrintOverhead(results[i], results[0], i + 1 == results.size());
+        std::printf("  ]\n}\n");
+        return 0;
+    }
+    if (mode == "pads")
+    {
+        std::vector<PadCheck> results;
+        RunPads(reps, quick, results);
+
+        std::printf("{\n  \"benchmark\": \"pads\",\n  \"reps\": %u,\n  \"dispatch\": \"%s\",\n  \"results\": [\n", reps,
+                    PatternName(PatternBest()));
+        for (size_t i = 0; i < results.size(); i++)
+            PrintPadCheck(results[i], i + 1 == results.size());
+        std::printf("  ]\n}\n");
+        return 0;
+    }
+    if (mode == "batch")
+    {
+        std::vector<Batch> results;
+        RunBatches(objects, reps, quick, results);
+
+        // Batch 0 is Allocate/Free one by one, the speedups are against it
+        std::printf("{\n  \"benchmark\": \"batch\",\n  \"objects\": %u,\n  \"reps\": %u,\n  \"object_size\": %u,\n"
+                    "  \"objects_per_page\": %u,\n  \"results\": [\n",
+                    static_cast<unsigned>(objects), reps, static_cast<unsigned>(SIZES[1]), PAGES[1]);
+        for (size_t i = 0; i < results.size(); i++)
+            PrintBatch(results[i], results[0], i + 1 == results.size());
+        std::printf("  ]\n}\n");
+        return 0;
+    }
+    if (mode != "patterns")
+    {
+        std::fprintf(stderr, "Unknown mode %s\n", mode.c_str());
+        return 1;
+    }
+
+    std::vector<Result> results;
+    RunPatterns(objects, reps, quick, results);
+
+    std::printf("{\n  \"benchmark\": \"patterns\",\n  \"objects\": %u,\n  \"reps\": %u,\n  \"results\": [\n",
+                static_cast<unsigned>(objects), reps);
+    for (size_t i = 0; i < results.size(); i++)
+        PrintResult(results[i], i + 1 == results.size());
+    std::printf("  ]\n}\n");
+    return 0;
+}
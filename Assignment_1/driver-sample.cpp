@@ -14,7 +14,27 @@ int SHOW_EXCEPTIONS = 0; // Show student exceptions in all tests
 int EXTRA_CREDIT    = 0; // Run extra credit tests (Alignment, FreeEmptyPages)
 
 #include "ObjectAllocator.h"
+#include "LockFreeAllocator.h"
+#include "MagazineAllocator.h"
+#include "SizeClassAllocator.h"
+#include "PoolAllocator.h"
+#include "PoolResource.h"
+#include "ObjectPool.h"
+#include "PatternCheck.h"
 #include "PRNG.h"
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <map>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 struct Student
 {
@@ -57,6 +77,26 @@ void TestFreeEmptyPages2(void);
 void TestFreeEmptyPages3(void);
 void StressFreeChecking(void);
 void Stress(bool UseNewDelete);
+void StressLockFree(unsigned threads);
+void BenchContainers(unsigned count);
+void BenchPoolResource(unsigned count);
+void TestObjectPool(unsigned count);
+void TestExternalLabels(unsigned count);
+void TestPatternChecks(void);
+void TestIncrementalValidate(void);
+void TestParallelScans(unsigned pages);
+void TestGuardPages(void);
+void TestQuarantine(void);
+void TestSlabPages(void);
+void TestSideHeaders(void);
+void TestMagazineQuarantine(void);
+void TestFreeEmptyPagesOrder(void);
+void TestPageSlack(void);
+void TestBatches(void);
+void TestSizeClasses(void);
+void TestLazyPages(void);
+void TestPageProviders(void);
+void StressMagazine(unsigned threads);
 
 struct Person
 {
@@ -129,119 +169,1555 @@ void DumpCallback(const void * block, size_t actual_size)
         if (c > 31 && c < 128) // printable range
             printf("%c", c);
         else
-            printf(" ");
+            printf(" ");
+    }
+    printf(">");
+
+    data = const_cast<unsigned char *>(static_cast<const unsigned char *>(block));
+    for (unsigned int i = 0; i < size; i++)
+        printf(" %02X", static_cast<int>(*data++));
+    printf("\n");
+}
+
+void DumpCallback2(const void *, size_t)
+{
+}
+
+void CheckAndDumpLeaks(const ObjectAllocator * oa)
+{
+    if (oa->GetStats().ObjectsInUse_)
+    {
+        printf("Detected memory leaks!\n");
+        printf("Dumping objects ->\n");
+        unsigned leaks = oa->DumpMemoryInUse(DumpCallback);
+        printf("Object dump complete. [%u]\n", leaks);
+    }
+    else
+        printf("No leaks detected.\n");
+}
+
+void ValidateCallback(const void * block, size_t actual_size)
+{
+    if (SHOWADDRESS2)
+        printf("Block at 0x%p, %u bytes long.\n", block, static_cast<unsigned>(actual_size));
+    else
+        printf("Block at 0x00000000, %u bytes long.\n", static_cast<unsigned>(actual_size));
+
+    if (!block)
+        return;
+}
+
+//****************************************************************************************************
+//****************************************************************************************************
+int RandomInt(int low, int high)
+{
+    //return std::rand() % (high - low + 1) + low;
+    return Digipen::Utils::Random(low, high);
+}
+
+template <typename T>
+void SwapT(T & a, T & b)
+{
+    T temp = a;
+    a      = b;
+    b      = temp;
+}
+
+template <typename T>
+void Shuffle(T * array, unsigned count)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        int r = RandomInt(static_cast<int>(i), static_cast<int>(count) - 1);
+        SwapT(array[i], array[r]);
+    }
+}
+
+template <typename T>
+void PrintArray(T * array, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        std::cout << array[i] << std::endl;
+}
+
+const unsigned objects = 4096;
+const unsigned pages   = 100;
+const unsigned total   = objects * pages;
+void *         ptrs[total];
+
+#include <ctime>
+void Stress(bool UseNewDelete)
+{
+    ObjectAllocator * oa;
+
+    try
+    {
+        bool                      newdel   = UseNewDelete;
+        bool                      debug    = false;
+        unsigned                  padbytes = 0;
+        OAConfig::HeaderBlockInfo header(OAConfig::hbNone);
+        unsigned                  alignment = 0;
+
+        OAConfig config(newdel, objects, pages, debug, padbytes, header, alignment);
+        oa = new ObjectAllocator(sizeof(Student), config);
+        for (unsigned i = 0; i < total; i++)
+        {
+            void * p = oa->Allocate();
+            ptrs[i]  = p;
+        }
+
+        Shuffle(ptrs, total);
+        for (unsigned i = 0; i < total; i++)
+        {
+            oa->Free(ptrs[i]);
+        }
+
+        delete oa;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during construction in Stress." << endl;
+
+        return;
+    }
+}
+
+// Same workload as Stress, split among threads that all share one LockFreeAllocator
+void StressLockFree(unsigned threads)
+{
+    LockFreeAllocator * oa;
+
+    try
+    {
+        OAConfig config(false, objects, pages);
+        oa = new LockFreeAllocator(sizeof(Student), config);
+
+        // every thread allocates its share of the objects
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++)
+        {
+            workers.push_back(std::thread([=]() {
+                for (unsigned i = t; i < total; i += threads)
+                    ptrs[i] = oa->Allocate();
+            }));
+        }
+        for (unsigned t = 0; t < threads; t++)
+            workers[t].join();
+        workers.clear();
+
+        // no block can be handed out twice
+        std::vector<void *> sorted(ptrs, ptrs + total);
+        std::sort(sorted.begin(), sorted.end());
+        bool duplicated = std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end();
+
+        // free them in random order while every thread also churns a few blocks of its own
+        Shuffle(ptrs, total);
+        for (unsigned t = 0; t < threads; t++)
+        {
+            workers.push_back(std::thread([=]() {
+                for (unsigned i = t; i < total; i += threads)
+                {
+                    oa->Free(ptrs[i]);
+                    void * p = oa->Allocate();
+                    oa->Free(p);
+                }
+            }));
+        }
+        for (unsigned t = 0; t < threads; t++)
+            workers[t].join();
+
+        // every block has to be back on the free list exactly once
+        sorted.clear();
+        for (const GenericObject * p = static_cast<const GenericObject *>(oa->GetFreeList()); p; p = p->Next)
+            sorted.push_back(const_cast<GenericObject *>(p));
+        std::sort(sorted.begin(), sorted.end());
+        duplicated = duplicated || std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end();
+
+        OAStats stats = oa->GetStats();
+        cout << "Pages in use: " << stats.PagesInUse_;
+        cout << ", Objects in use: " << stats.ObjectsInUse_;
+        cout << ", Available objects: " << stats.FreeObjects_;
+        cout << ", On free list: " << sorted.size() << endl;
+        if (duplicated || sorted.size() != total || stats.ObjectsInUse_ != 0)
+            cout << "Lost or duplicated blocks in StressLockFree." << endl;
+
+        delete oa;
+
+        // objects have to hold an aligned link, too small or misaligning sizes are rejected
+        const size_t bad[] = {2, sizeof(void *) + 1};
+        unsigned rejected = 0;
+        for (size_t i = 0; i < 2; i++)
+        {
+            try
+            {
+                LockFreeAllocator small(bad[i], config);
+            }
+            catch (const OAException & e)
+            {
+                rejected += e.code() == OAException::E_BAD_BOUNDARY;
+            }
+        }
+        cout << "Sizes that can't hold a link rejected: " << rejected << " of 2" << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during StressLockFree." << endl;
+
+        return;
+    }
+}
+
+// Inserts count keys, iterates over them and erases them one by one, returns the sum seen
+template <typename Container, typename Insert>
+long long ContainerWorkload(Container & container, const std::vector<int> & keys, Insert insert, double & ms)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++)
+        insert(container, keys[i]);
+
+    long long sum = 0;
+    for (int round = 0; round < 4; round++)
+        for (typename Container::const_iterator it = container.begin(); it != container.end(); ++it)
+            sum += insert.Key(*it);
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        typename Container::iterator it = container.begin();
+        container.erase(it);
+    }
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return sum;
+}
+
+// Same workload on containers using std::allocator and PoolAllocator
+template <typename StdContainer, typename PoolContainer, typename Insert>
+void CompareContainers(const char * name, const std::vector<int> & keys, Insert insert)
+{
+    double stdMs;
+    double poolMs;
+    StdContainer  stdContainer;
+    PoolContainer poolContainer;
+    long long expected = ContainerWorkload(stdContainer, keys, insert, stdMs);
+    long long sum = ContainerWorkload(poolContainer, keys, insert, poolMs);
+
+    printf("%-14s std::allocator %8.2f ms, PoolAllocator %8.2f ms\n", name, stdMs, poolMs);
+    if (sum != expected || !poolContainer.empty())
+        cout << "Wrong contents in " << name << " using PoolAllocator." << endl;
+}
+
+struct InsertBack
+{
+    template <typename Container>
+    void operator()(Container & c, int key) const
+    {
+        c.push_back(key);
+    }
+    int Key(int value) const
+    {
+        return value;
+    }
+};
+
+struct InsertKey
+{
+    template <typename Container>
+    void operator()(Container & c, int key) const
+    {
+        c.insert(key);
+    }
+    int Key(int value) const
+    {
+        return value;
+    }
+};
+
+struct InsertPair
+{
+    template <typename Container>
+    void operator()(Container & c, int key) const
+    {
+        c.insert(std::make_pair(key, key));
+    }
+    int Key(const std::pair<const int, int> & value) const
+    {
+        return value.first + value.second;
+    }
+};
+
+// Insert/iterate/erase throughput of node based containers, std::allocator against PoolAllocator
+void BenchContainers(unsigned count)
+{
+    std::vector<int> keys(count);
+    for (unsigned i = 0; i < count; i++)
+        keys[i] = static_cast<int>(i);
+    Shuffle(&keys[0], count);
+
+    try
+    {
+        CompareContainers<std::list<int>, std::list<int, PoolAllocator<int> > >("list", keys, InsertBack());
+        CompareContainers<std::set<int>, std::set<int, std::less<int>, PoolAllocator<int> > >("set", keys, InsertKey());
+        CompareContainers<std::map<int, int>,
+                          std::map<int, int, std::less<int>, PoolAllocator<std::pair<const int, int> > > >("map", keys, InsertPair());
+        CompareContainers<std::unordered_map<int, int>,
+                          std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, PoolAllocator<std::pair<const int, int> > > >(
+            "unordered_map", keys, InsertPair());
+
+        // copies and rebinds share the pools, separate allocators don't
+        PoolAllocator<int> a;
+        PoolAllocator<double> b(a);
+        PoolAllocator<int> c;
+        if (!(a == b) || a == c)
+            cout << "Wrong PoolAllocator equality." << endl;
+    }
+    catch (const std::bad_alloc &)
+    {
+        cout << "Exception thrown during BenchContainers." << endl;
+    }
+}
+
+#ifdef OA_HAS_PMR
+// pmr containers of every kind filled and emptied on one resource, returns a checksum
+long long PmrWorkload(std::pmr::memory_resource * resource, const std::vector<int> & keys, double & ms)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    {
+        std::pmr::vector<std::pmr::string> strings(resource);
+        std::pmr::list<int> list(resource);
+        std::pmr::map<int, int> map(resource);
+        std::pmr::unordered_map<int, int> hash(resource);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            // long enough to skip the small string buffer
+            strings.emplace_back(24 + keys[i] % 40, static_cast<char>('a' + keys[i] % 26));
+            list.push_back(keys[i]);
+            map.emplace(keys[i], keys[i]);
+            hash.emplace(keys[i], keys[i]);
+        }
+        for (size_t i = 0; i < strings.size(); i++)
+            sum += strings[i].size();
+        for (std::pmr::list<int>::const_iterator it = list.begin(); it != list.end(); ++it)
+            sum += *it;
+        for (std::pmr::map<int, int>::const_iterator it = map.begin(); it != map.end(); ++it)
+            sum += it->second;
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            list.pop_front();
+            map.erase(keys[i]);
+            hash.erase(keys[i]);
+        }
+        sum += list.size() + map.size() + hash.size();
+    }
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return sum;
+}
+#endif
+
+// Same pmr workload on PoolResource and std::pmr::unsynchronized_pool_resource
+void BenchPoolResource(unsigned count)
+{
+#ifdef OA_HAS_PMR
+    std::vector<int> keys(count);
+    for (unsigned i = 0; i < count; i++)
+        keys[i] = static_cast<int>(i);
+    Shuffle(&keys[0], count);
+
+    try
+    {
+        double stdMs;
+        double poolMs;
+        std::pmr::unsynchronized_pool_resource standard;
+        PoolResource pool;
+        long long expected = PmrWorkload(&standard, keys, stdMs);
+        long long sum = PmrWorkload(&pool, keys, poolMs);
+
+        printf("unsynchronized_pool_resource %8.2f ms, PoolResource %8.2f ms\n", stdMs, poolMs);
+        OAStats stats = pool.GetStats();
+        if (sum != expected || stats.ObjectsInUse_ != 0 || stats.Allocations_ != stats.Deallocations_)
+            cout << "Wrong contents or leaked blocks using PoolResource." << endl;
+    }
+    catch (const std::bad_alloc &)
+    {
+        cout << "Exception thrown during BenchPoolResource." << endl;
+    }
+#else
+    (void)count;
+    cout << "std::pmr needs C++17, nothing to test." << endl;
+#endif
+}
+
+// Counts live objects so create/destroy can be checked
+struct Tracked
+{
+    static int Live;
+    Student    data;
+    Tracked(int age, float gpa)
+    {
+        data.Age  = age;
+        data.GPA  = gpa;
+        data.Year = 0;
+        data.ID   = 0;
+        Live++;
+    }
+    ~Tracked()
+    {
+        Live--;
+    }
+};
+int Tracked::Live = 0;
+
+typedef PoolPolicy<4, 3, true, 2, OAConfig::hbExtended, 2, 8> DebugPoolPolicy;
+
+// ObjectPool layout against ObjectAllocator, create/destroy, debug checks and release speed
+void TestObjectPool(unsigned count)
+{
+    try
+    {
+        // same layout as the runtime allocator for the same settings
+        OAConfig config(false, 4, 3, true, 2, OAConfig::HeaderBlockInfo(OAConfig::hbExtended, 2), 8);
+        ObjectAllocator oa(sizeof(Student), config);
+        typedef ObjectPool<Student, DebugPoolPolicy> DebugPool;
+        if (DebugPool::PageSize != oa.GetStats().PageSize_ || DebugPool::LeftAlignSize != oa.GetConfig().LeftAlignSize_ ||
+            DebugPool::InterAlignSize != oa.GetConfig().InterAlignSize_)
+            cout << "ObjectPool layout differs from ObjectAllocator." << endl;
+
+        // constructors and destructors run, nothing is left behind
+        {
+            ObjectPool<Tracked, PoolPolicy<4, 2, true, 4, OAConfig::hbExternal> > pool;
+            std::vector<Tracked *> objects;
+            for (int i = 0; i < 8; i++)
+                objects.push_back(pool.create(i, 1.5f));
+            bool values = objects[5]->data.Age == 5 && Tracked::Live == 8;
+            for (size_t i = 0; i < objects.size(); i++)
+                pool.destroy(objects[i]);
+            cout << "create/destroy: " << (values && Tracked::Live == 0 ? "ok" : "wrong") << endl;
+        }
+
+        // double free and corruption are caught with DebugOn_
+        ObjectPool<Student, PoolPolicy<4, 1, true, 2> > checked;
+        Student * s = checked.create();
+        checked.destroy(s);
+        try
+        {
+            checked.Free(s);
+            cout << "Double free not detected." << endl;
+        }
+        catch (const OAException & e)
+        {
+            cout << "Double free: " << (e.code() == OAException::E_MULTIPLE_FREE ? "detected" : "wrong code") << endl;
+        }
+        s = checked.create();
+        reinterpret_cast<unsigned char *>(s)[sizeof(Student)] = 0;
+        cout << "ValidatePages: " << checked.ValidatePages(DumpCallback2) << " corrupted" << endl;
+        try
+        {
+            checked.Free(s);
+            cout << "Corruption not detected." << endl;
+        }
+        catch (const OAException & e)
+        {
+            cout << "Corruption: " << (e.code() == OAException::E_CORRUPTED_BLOCK ? "detected" : "wrong code") << endl;
+        }
+
+        // release policy against ObjectAllocator with no debugging
+        std::vector<void *> blocks(count);
+        OAConfig fast(false, 4096, 0);
+        ObjectAllocator runtime(sizeof(Student), fast);
+        ObjectPool<Student> typed;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int round = 0; round < 4; round++)
+        {
+            for (unsigned i = 0; i < count; i++)
+                blocks[i] = runtime.Allocate();
+            for (unsigned i = 0; i < count; i++)
+                runtime.Free(blocks[i]);
+        }
+        double runtimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < 4; round++)
+        {
+            for (unsigned i = 0; i < count; i++)
+                blocks[i] = typed.Allocate();
+            for (unsigned i = 0; i < count; i++)
+                typed.Free(blocks[i]);
+        }
+        double typedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("ObjectAllocator %8.2f ms, ObjectPool %8.2f ms\n", runtimeMs, typedMs);
+        if (typed.GetStats().ObjectsInUse_ != 0 || typed.GetStats().Allocations_ != 4 * count)
+            cout << "Wrong stats using ObjectPool." << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestObjectPool." << endl;
+    }
+}
+
+// External header record of a block in use
+const MemBlockInfo * ExternalHeader(const ObjectAllocator * oa, const void * block)
+{
+    const char * header = static_cast<const char *>(block) - oa->GetConfig().PadBytes_ - oa->GetConfig().HBlockInfo_.size_;
+    return *reinterpret_cast<MemBlockInfo * const *>(header);
+}
+
+// Labels of external headers are interned, or kept as given with StaticLabels_
+void TestExternalLabels(unsigned count)
+{
+    try
+    {
+        static const char * names[] = {"Student", "Employee", "a label long enough to skip small buffers"};
+        OAConfig config(false, 256, 0, true, 2, OAConfig::HeaderBlockInfo(OAConfig::hbExternal));
+        ObjectAllocator interned(sizeof(Student), config);
+        config.StaticLabels_ = true;
+        ObjectAllocator literal(sizeof(Student), config);
+
+        // same text from different buffers ends up in one copy
+        char buffer[64];
+        strcpy(buffer, names[2]);
+        void * a = interned.Allocate(names[2]);
+        void * b = interned.Allocate(buffer);
+        void * c = literal.Allocate(names[0]);
+        bool shared = ExternalHeader(&interned, a)->label == ExternalHeader(&interned, b)->label &&
+                      ExternalHeader(&interned, a)->label != names[2];
+        bool kept = ExternalHeader(&literal, c)->label == names[0];
+        cout << "Interned labels shared: " << (shared ? "yes" : "no") << ", literal labels kept: " << (kept ? "yes" : "no") << endl;
+        interned.Free(a);
+        interned.Free(b);
+        literal.Free(c);
+
+        // churn with labels, the records and labels are reused (labels are kept until the allocator goes)
+        std::vector<void *> blocks(count);
+        size_t stored = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int round = 0; round < 4; round++)
+        {
+            for (unsigned i = 0; i < count; i++)
+                blocks[i] = interned.Allocate(names[i % 3]);
+            stored = interned.GetLabelCount();
+            Shuffle(&blocks[0], count);
+            for (unsigned i = 0; i < count; i++)
+                interned.Free(blocks[i]);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("External headers: %u allocations in %8.2f ms\n", 4 * count, ms);
+        cout << "Labels stored: " << stored << " while in use, " << interned.GetLabelCount() << " after freeing (kept)" << endl;
+        CheckAndDumpLeaks(&interned);
+
+        // the typed pool keeps its records and labels the same way
+        ObjectPool<Student, PoolPolicy<256, 0, true, 2, OAConfig::hbExternal> > pool;
+        Student * s = static_cast<Student *>(pool.Allocate(names[2]));
+        Student * t = static_cast<Student *>(pool.Allocate(buffer));
+        MemBlockInfo * si;
+        MemBlockInfo * ti;
+        memcpy(&si, reinterpret_cast<char *>(s) - 2 - sizeof(si), sizeof(si));
+        memcpy(&ti, reinterpret_cast<char *>(t) - 2 - sizeof(ti), sizeof(ti));
+        cout << "Pool labels shared: " << (si->label == ti->label && si->label != names[2] ? "yes" : "no")
+             << ", stored: " << pool.GetLabelCount();
+        pool.Free(s);
+        pool.Free(t);
+        cout << ", after freeing: " << pool.GetLabelCount() << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestExternalLabels." << endl;
+    }
+}
+
+// Every supported pattern check finds a single wrong byte anywhere, at any alignment
+void TestPatternChecks(void)
+{
+    const PATTERN_IMPL impls[] = {piScalar, piWord, piSSE2, piAVX2};
+    const unsigned char pad = ObjectAllocator::PAD_PATTERN;
+    std::vector<unsigned char> buffer(512 + 8);
+    unsigned wrong = 0;
+    for (size_t k = 0; k < sizeof(impls) / sizeof(*impls); k++)
+    {
+        if (!PatternSupported(impls[k]))
+            continue;
+        for (size_t offset = 0; offset < 8; offset++)
+        {
+            for (size_t size = 0; size <= 300; size++)
+            {
+                std::fill(buffer.begin(), buffer.end(), pad);
+                if (!PatternMatches(impls[k], &buffer[offset], size, pad))
+                    wrong++;
+                for (size_t bad = 0; bad < size; bad++)
+                {
+                    buffer[offset + bad] = ObjectAllocator::FREED_PATTERN;
+                    if (PatternMatches(impls[k], &buffer[offset], size, pad))
+                        wrong++;
+                    buffer[offset + bad] = pad;
+                }
+            }
+        }
+    }
+    cout << "Pattern checks: " << (wrong ? "wrong" : "ok") << endl;
+}
+
+// Incremental ValidatePages finds the same corrupted blocks as a full one, in small slices
+void TestIncrementalValidate(void)
+{
+    try
+    {
+        OAConfig config(false, 64, 0, true, 4, OAConfig::HeaderBlockInfo(OAConfig::hbBasic));
+        ObjectAllocator oa(sizeof(Student), config);
+        std::vector<void *> blocks;
+        for (unsigned i = 0; i < 1000; i++)
+            blocks.push_back(oa.Allocate());
+        for (unsigned i = 0; i < blocks.size(); i += 97)
+            static_cast<unsigned char *>(blocks[i])[sizeof(Student)] = 0;
+
+        unsigned full = oa.ValidatePages(DumpCallback2);
+
+        // slices of 50 blocks until one sweep is over
+        OAValidateCursor cursor;
+        unsigned found = 0;
+        unsigned calls = 0;
+        while (cursor.Sweeps == 0)
+        {
+            found += oa.ValidatePages(DumpCallback2, cursor, 50);
+            calls++;
+        }
+        cout << "Full: " << full << ", incremental: " << found << " in " << calls << " calls" << endl;
+
+        // pages freed and created between slices don't lose the cursor
+        cursor = OAValidateCursor();
+        found = oa.ValidatePages(DumpCallback2, cursor, 300);
+        for (unsigned i = 512; i < 576; i++)
+            oa.Free(blocks[i]);
+        oa.FreeEmptyPages();
+        blocks.push_back(oa.Allocate());
+        while (cursor.Sweeps == 0)
+            found += oa.ValidatePages(DumpCallback2, cursor, 50);
+        cout << "After freeing pages: " << found << " found" << endl;
+
+        // a time budget stops a call early
+        cursor = OAValidateCursor();
+        found = 0;
+        calls = 0;
+        while (cursor.Sweeps == 0)
+        {
+            found += oa.ValidatePages(DumpCallback2, cursor, ~0u, 1);
+            calls++;
+        }
+        cout << "Time sliced: " << found << " found, " << (calls > 1 ? "several calls" : "one call") << endl;
+
+        // no limit at all finishes the sweep from where the cursor is
+        cursor = OAValidateCursor();
+        found = oa.ValidatePages(DumpCallback2, cursor, 300);
+        found += oa.ValidatePages(DumpCallback2, cursor, 0);
+        cout << "No limit: " << found << " found, sweep over: " << (cursor.Sweeps == 1 ? "yes" : "no") << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestIncrementalValidate." << endl;
+    }
+}
+
+std::vector<const void *> SeenBlocks;
+void CollectCallback(const void * block, size_t)
+{
+    SeenBlocks.push_back(block);
+}
+
+// Parallel DumpMemoryInUse and ValidatePages report the same blocks as the sequential ones
+void TestParallelScans(unsigned pages)
+{
+    try
+    {
+        OAConfig config(false, 4096, 0, true, 16);
+        ObjectAllocator oa(sizeof(Student), config);
+        std::vector<void *> blocks(pages * 4096);
+        for (size_t i = 0; i < blocks.size(); i++)
+            blocks[i] = oa.Allocate();
+        for (size_t i = 0; i < blocks.size(); i += 2)
+            oa.Free(blocks[i]);
+        for (size_t i = 1; i < blocks.size(); i += 1001)
+            static_cast<unsigned char *>(blocks[i])[-1] = 0;
+
+        SeenBlocks.clear();
+        unsigned dumped = oa.DumpMemoryInUse(CollectCallback);
+        std::vector<const void *> expected = SeenBlocks;
+        std::sort(expected.begin(), expected.end());
+        SeenBlocks.clear();
+        unsigned dumpedParallel = oa.DumpMemoryInUse(CollectCallback, 4);
+        bool ordered = std::is_sorted(SeenBlocks.begin(), SeenBlocks.end());
+        cout << "DumpMemoryInUse: " << dumped << ", parallel: " << dumpedParallel << ", same blocks in address order: "
+             << (ordered && SeenBlocks == expected ? "yes" : "no") << endl;
+
+        SeenBlocks.clear();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        unsigned corrupted = oa.ValidatePages(CollectCallback);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        expected = SeenBlocks;
+        std::sort(expected.begin(), expected.end());
+        SeenBlocks.clear();
+        start = std::chrono::steady_clock::now();
+        unsigned corruptedParallel = oa.ValidatePages(CollectCallback, 0);
+        double parallelMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        cout << "ValidatePages: " << corrupted << ", parallel: " << corruptedParallel << ", same blocks: "
+             << (SeenBlocks == expected ? "yes" : "no") << endl;
+        printf("ValidatePages %8.2f ms, parallel %8.2f ms\n", ms, parallelMs);
+
+        // more workers than pages
+        SeenBlocks.clear();
+        OAConfig small(false, 4, 1, true, 2);
+        ObjectAllocator tiny(sizeof(Student), small);
+        tiny.Allocate();
+        cout << "One page, 8 workers: " << tiny.DumpMemoryInUse(CollectCallback, 8) << " in use" << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestParallelScans." << endl;
+    }
+}
+
+#ifndef _WIN32
+// Runs write in a child process, true if the child died of a memory fault
+template <typename Write>
+bool Faults(Write write)
+{
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0)
+    {
+        write();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    return WIFSIGNALED(status) && (WTERMSIG(status) == SIGSEGV || WTERMSIG(status) == SIGBUS);
+}
+#endif
+
+// With GuardPages_ the first byte past the end of a page faults right away
+void TestGuardPages(void)
+{
+#ifndef _WIN32
+    try
+    {
+        OAConfig config(false, 1, 0);
+        config.GuardPages_ = true;
+        ObjectAllocator oa(sizeof(Student), config);
+        std::vector<unsigned char *> blocks;
+        for (int i = 0; i < 16; i++)
+            blocks.push_back(static_cast<unsigned char *>(oa.Allocate()));
+
+        unsigned char * last = blocks[7];
+        bool inside = Faults([=]() { memset(last, 0, sizeof(Student)); });
+        bool outside = Faults([=]() { last[sizeof(Student)] = 0; });
+        cout << "Write inside the object faults: " << (inside ? "yes" : "no") << endl;
+        cout << "Write one byte past the object faults: " << (outside ? "yes" : "no") << endl;
+
+        for (size_t i = 0; i < blocks.size(); i++)
+            oa.Free(blocks[i]);
+        cout << "Pages freed: " << oa.FreeEmptyPages() << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestGuardPages." << endl;
+    }
+#else
+    cout << "Guard page faults are only tested on POSIX." << endl;
+#endif
+}
+
+void TestQuarantine(void)
+{
+    try
+    {
+        // 4 blocks held back, 2 pages of 4
+        OAConfig config(false, 4, 2);
+        config.QuarantineObjects_ = 4;
+        ObjectAllocator oa(sizeof(Student), config);
+
+        void * first = oa.Allocate();
+        oa.Free(first);
+        void * next = oa.Allocate();
+        cout << "Freed block reused right away: " << (next == first ? "yes" : "no") << endl;
+        cout << "Quarantined: " << oa.GetStats().Quarantined_ << ", free: " << oa.GetStats().FreeObjects_ << endl;
+
+        // Write to the freed block, it is caught when it leaves the quarantine
+        unsigned char * stale = static_cast<unsigned char *>(first);
+        stale[0] = 0;
+        std::vector<void *> blocks;
+        for (int i = 0; i < 4; i++)
+            blocks.push_back(oa.Allocate());
+        bool caught = false;
+        for (size_t i = 0; i < blocks.size(); i++)
+        {
+            try
+            {
+                oa.Free(blocks[i]);
+            }
+            catch (const OAException & e)
+            {
+                caught = e.code() == OAException::E_CORRUPTED_BLOCK;
+            }
+        }
+        cout << "Use after free caught on eviction: " << (caught ? "yes" : "no") << endl;
+
+        // Out of pages, the allocations take the blocks that waited the longest
+        blocks.clear();
+        for (int i = 0; i < 7; i++)
+            blocks.push_back(oa.Allocate());
+        cout << "Allocated with every page in use: " << blocks.size() << ", pages: " << oa.GetStats().PagesInUse_
+             << ", quarantined: " << oa.GetStats().Quarantined_ << endl;
+        for (size_t i = 0; i < blocks.size(); i++)
+            oa.Free(blocks[i]);
+        oa.Free(next);
+        cout << "Pages freed: " << oa.FreeEmptyPages() << ", quarantined: " << oa.GetStats().Quarantined_
+             << ", free: " << oa.GetStats().FreeObjects_ << endl;
+
+        // A byte limit smaller than one object still holds one back
+        OAConfig tiny(false, 4, 0);
+        tiny.QuarantineBytes_ = 8;
+        ObjectAllocator small(sizeof(Student), tiny);
+        void * block = small.Allocate();
+        small.Free(block);
+        cout << "8 byte limit, quarantined: " << small.GetStats().Quarantined_ << endl;
+
+        // A huge byte limit only takes slots for the blocks freed so far
+        OAConfig huge(false, 64, 0);
+        huge.QuarantineBytes_ = 1u << 30;
+        ObjectAllocator big(sizeof(Student), huge);
+        blocks.clear();
+        std::set<void *> freed;
+        for (int i = 0; i < 100; i++)
+        {
+            blocks.push_back(big.Allocate());
+            freed.insert(blocks.back());
+        }
+        for (int i = 0; i < 100; i++)
+        {
+            big.Free(blocks.back());
+            blocks.pop_back();
+        }
+        int reused = 0;
+        for (int i = 0; i < 100; i++)
+            reused += static_cast<int>(freed.count(big.Allocate()));
+        cout << "1 GB limit, quarantined: " << big.GetStats().Quarantined_ << ", reused: " << reused << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestQuarantine." << endl;
+    }
+}
+
+void TestSlabPages(void)
+{
+    try
+    {
+        for (int slab = 0; slab < 2; slab++)
+        {
+            OAConfig config(false, 16, 0, true, 4);
+            config.SlabPages_ = slab != 0;
+            ObjectAllocator oa(sizeof(Student), config);
+
+            // 4 full pages, then half of every page freed a page at a time
+            std::vector<void *> blocks;
+            std::map<void *, int> pageOf;
+            for (int i = 0; i < 64; i++)
+            {
+                blocks.push_back(oa.Allocate());
+                pageOf[blocks.back()] = i / 16;
+            }
+            for (int k = 0; k < 8; k++)
+            {
+                for (int p = 0; p < 4; p++)
+                {
+                    oa.Free(blocks[p * 16 + 2 * k]);
+                    blocks[p * 16 + 2 * k] = nullptr;
+                }
+            }
+            std::set<int> used;
+            for (int i = 0; i < 8; i++)
+            {
+                void * block = oa.Allocate();
+                used.insert(pageOf[block]);
+                blocks.push_back(block);
+            }
+            cout << (slab ? "Slab pages" : "Free list") << ", pages used by 8 allocations: " << used.size() << endl;
+
+            // Churn, then free most of what is left
+            blocks.erase(std::remove(blocks.begin(), blocks.end(), static_cast<void *>(nullptr)), blocks.end());
+            for (int i = 0; i < 20000; i++)
+            {
+                if (blocks.size() < 256 && (blocks.empty() || RandomInt(0, 1)))
+                    blocks.push_back(oa.Allocate());
+                else
+                {
+                    size_t victim = static_cast<size_t>(RandomInt(0, static_cast<int>(blocks.size()) - 1));
+                    oa.Free(blocks[victim]);
+                    blocks[victim] = blocks.back();
+                    blocks.pop_back();
+                }
+                if (i % 16 == 0)
+                {
+                    void * batch[8];
+                    oa.AllocateBatch(8, batch);
+                    oa.FreeBatch(batch, 8);
+                }
+            }
+            while (blocks.size() > 64)
+            {
+                oa.Free(blocks.back());
+                blocks.pop_back();
+            }
+            OAStats stats = oa.GetStats();
+            bool consistent = stats.FreeObjects_ + stats.ObjectsInUse_ == stats.PagesInUse_ * 16 && oa.ValidatePages(DumpCallback) == 0;
+            unsigned pages = stats.PagesInUse_;
+            unsigned freed = oa.FreeEmptyPages();
+            cout << "  " << blocks.size() << " objects left on " << pages - freed << " of " << pages << " pages, consistent: "
+                 << (consistent ? "yes" : "no") << endl;
+
+            for (size_t i = 0; i < blocks.size(); i++)
+                oa.Free(blocks[i]);
+            cout << "  Pages freed at the end: " << oa.FreeEmptyPages() << ", pages left: " << oa.GetStats().PagesInUse_ << endl;
+        }
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestSlabPages." << endl;
+    }
+}
+
+void TestSideHeaders(void)
+{
+    const OAConfig::HeaderBlockInfo headers[] = {OAConfig::HeaderBlockInfo(OAConfig::hbBasic),
+                                                 OAConfig::HeaderBlockInfo(OAConfig::hbExtended, 4),
+                                                 OAConfig::HeaderBlockInfo(OAConfig::hbExternal)};
+    const char * names[] = {"basic", "extended", "external"};
+    for (int h = 0; h < 3; h++)
+    {
+        try
+        {
+            for (int side = 0; side < 2; side++)
+            {
+                OAConfig config(false, 8, 0, true, 2, headers[h]);
+                config.SideHeaders_ = side != 0;
+                ObjectAllocator oa(sizeof(Student), config);
+                char * a = static_cast<char *>(oa.Allocate("first"));
+                char * b = static_cast<char *>(oa.Allocate("second"));
+                oa.Free(a);
+                a = static_cast<char *>(oa.Allocate("third"));
+
+                // b was handed out after a, both are on the first page
+                const char * header = static_cast<const char *>(oa.GetHeader(b));
+                cout << names[h] << (side ? ", side table" : ", inline") << ": stride " << (a > b ? a - b : b - a)
+                     << ", page " << oa.GetStats().PageSize_;
+                if (headers[h].type_ == OAConfig::hbBasic)
+                    cout << ", alloc " << *reinterpret_cast<const unsigned *>(header) << ", flag " << int(header[4]);
+                else if (headers[h].type_ == OAConfig::hbExtended)
+                    cout << ", uses " << *reinterpret_cast<const short *>(static_cast<const char *>(oa.GetHeader(a)) + 4) << ", alloc "
+                         << *reinterpret_cast<const unsigned *>(header + 6) << ", flag " << int(header[10]);
+                else
+                    cout << ", label " << (*reinterpret_cast<MemBlockInfo * const *>(header))->label;
+                cout << endl;
+
+                oa.Free(b);
+                try
+                {
+                    oa.Free(b);
+                    cout << "  Double free not caught" << endl;
+                }
+                catch (const OAException & e)
+                {
+                    cout << "  Double free caught: " << (e.code() == OAException::E_MULTIPLE_FREE ? "yes" : "no") << endl;
+                }
+                oa.Free(a);
+            }
+        }
+        catch (const OAException & e)
+        {
+            if (SHOW_EXCEPTIONS)
+                cout << e.what() << endl;
+            else
+                cout << "Exception thrown during TestSideHeaders." << endl;
+        }
+    }
+}
+
+void TestMagazineQuarantine(void)
+{
+    try
+    {
+        // One page of 16, the depot holds 2 freed blocks back, magazines of 4
+        OAConfig config(false, 16, 1);
+        config.QuarantineObjects_ = 2;
+        MagazineAllocator ma(sizeof(Student), config, 4);
+
+        std::vector<void *> blocks;
+        for (int i = 0; i < 16; i++)
+            blocks.push_back(ma.Allocate());
+
+        // The 5th Free flushes blocks 0 and 1 to the quarantine, block 0 is then written after free.
+        // Flushing blocks 2 and 3 evicts it and throws
+        int caught = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            if (i == 6)
+                static_cast<unsigned char *>(blocks[0])[0] = 0;
+            try
+            {
+                ma.Free(blocks[i]);
+            }
+            catch (const OAException & e)
+            {
+                if (e.code() == OAException::E_CORRUPTED_BLOCK)
+                    caught++;
+            }
+        }
+        ma.Flush();
+        cout << "Corrupted blocks caught by a flush: " << caught << endl;
+
+        // Every block comes back exactly once
+        std::set<void *> unique;
+        unsigned handed = 0;
+        try
+        {
+            for (;;)
+            {
+                unique.insert(ma.Allocate());
+                handed++;
+            }
+        }
+        catch (const OAException & e)
+        {
+            cout << "Stopped with " << (e.code() == OAException::E_NO_PAGES ? "E_NO_PAGES" : "another error") << endl;
+        }
+        cout << "Blocks handed out: " << handed << ", unique: " << unique.size() << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestMagazineQuarantine." << endl;
+    }
+}
+
+void TestFreeEmptyPagesOrder(void)
+{
+    try
+    {
+        // 64 pages with every other block free, then one page emptied in random order
+        OAConfig config(false, 32, 0);
+        ObjectAllocator oa(sizeof(Student), config);
+        std::vector<void *> blocks;
+        for (int i = 0; i < 64 * 32; i++)
+            blocks.push_back(oa.Allocate());
+        for (size_t i = 0; i < blocks.size(); i += 2)
+            oa.Free(blocks[i]);
+        std::vector<void *> page;
+        for (int i = 1; i < 32; i += 2)
+            page.push_back(blocks[20 * 32 + i]);
+        Shuffle(&page[0], static_cast<unsigned>(page.size()));
+        for (size_t i = 0; i < page.size(); i++)
+            oa.Free(page[i]);
+
+        // The free list without the blocks of that page, in the same order
+        std::set<void *> emptied;
+        for (int i = 0; i < 32; i++)
+            emptied.insert(blocks[20 * 32 + i]);
+        std::vector<const void *> expected;
+        for (const GenericObject * p = static_cast<const GenericObject *>(oa.GetFreeList()); p; p = p->Next)
+        {
+            if (!emptied.count(const_cast<GenericObject *>(p)))
+                expected.push_back(p);
+        }
+
+        unsigned freed = oa.FreeEmptyPages();
+        std::vector<const void *> left;
+        for (const GenericObject * p = static_cast<const GenericObject *>(oa.GetFreeList()); p; p = p->Next)
+            left.push_back(p);
+        cout << "Pages freed: " << freed << ", free objects: " << oa.GetStats().FreeObjects_ << endl;
+        cout << "Rest of the free list kept in order: " << (left == expected ? "yes" : "no") << endl;
+
+        // The list still works, the blocks come back in LIFO order
+        void * next = oa.Allocate();
+        cout << "Next block is the old head: " << (next == expected[0] ? "yes" : "no") << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestFreeEmptyPagesOrder." << endl;
     }
-    printf(">");
-
-    data = const_cast<unsigned char *>(static_cast<const unsigned char *>(block));
-    for (unsigned int i = 0; i < size; i++)
-        printf(" %02X", static_cast<int>(*data++));
-    printf("\n");
 }
 
-void DumpCallback2(const void *, size_t)
+void TestPageSlack(void)
 {
-}
+    try
+    {
+        // 4 objects on a page rounded up to a whole OS page
+        OAConfig config(false, 4, 0, true, 2);
+        config.MmapPages_ = true;
+        ObjectAllocator oa(sizeof(Student), config);
+        char * last = static_cast<char *>(oa.Allocate());
+        char * before = static_cast<char *>(oa.Allocate());
+        size_t stride = static_cast<size_t>(last - before);
+        cout << "Page size: " << oa.GetStats().PageSize_ << ", stride: " << stride << endl;
 
-void CheckAndDumpLeaks(const ObjectAllocator * oa)
-{
-    if (oa->GetStats().ObjectsInUse_)
+        // Lines up with the stride but is past the last block
+        try
+        {
+            oa.Free(last + stride);
+            cout << "Free past the last block accepted" << endl;
+        }
+        catch (const OAException & e)
+        {
+            cout << "Free past the last block: " << (e.code() == OAException::E_BAD_BOUNDARY ? "E_BAD_BOUNDARY" : "wrong code")
+                 << endl;
+        }
+        oa.Free(last);
+        oa.Free(before);
+        cout << "Objects in use: " << oa.GetStats().ObjectsInUse_ << endl;
+    }
+    catch (const OAException & e)
     {
-        printf("Detected memory leaks!\n");
-        printf("Dumping objects ->\n");
-        unsigned leaks = oa->DumpMemoryInUse(DumpCallback);
-        printf("Object dump complete. [%u]\n", leaks);
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestPageSlack." << endl;
     }
-    else
-        printf("No leaks detected.\n");
 }
 
-void ValidateCallback(const void * block, size_t actual_size)
+void TestBatches(void)
 {
-    if (SHOWADDRESS2)
-        printf("Block at 0x%p, %u bytes long.\n", block, static_cast<unsigned>(actual_size));
-    else
-        printf("Block at 0x00000000, %u bytes long.\n", static_cast<unsigned>(actual_size));
+    try
+    {
+        // 2 pages of 8, debug on so FreeBatch checks every pointer
+        OAConfig config(false, 8, 2);
+        config.DebugOn_ = true;
+        ObjectAllocator oa(sizeof(Student), config);
+        void * blocks[16];
+        oa.AllocateBatch(5, blocks);
+        PrintCounts(&oa);
 
-    if (!block)
-        return;
-}
+        // 12 more don't fit in 2 pages, nothing is allocated and the free list is left alone
+        const void * head = oa.GetFreeList();
+        try
+        {
+            oa.AllocateBatch(12, blocks + 5);
+            cout << "Batch past MaxPages accepted" << endl;
+        }
+        catch (const OAException & e)
+        {
+            cout << "Batch past MaxPages: " << (e.code() == OAException::E_NO_PAGES ? "E_NO_PAGES" : "wrong code") << endl;
+        }
+        PrintCounts(&oa);
+        cout << "Free list head unchanged: " << (oa.GetFreeList() == head ? "yes" : "no") << endl;
 
-//****************************************************************************************************
-//****************************************************************************************************
-int RandomInt(int low, int high)
-{
-    //return std::rand() % (high - low + 1) + low;
-    return Digipen::Utils::Random(low, high);
+        // 11 fit exactly
+        oa.AllocateBatch(11, blocks + 5);
+        PrintCounts(&oa);
+
+        // A bad pointer in the middle, the 3 before it are freed and the rest are not
+        void * ptrs[6] = {blocks[0], blocks[1], blocks[2], static_cast<char *>(blocks[3]) + 1, blocks[4], blocks[5]};
+        try
+        {
+            oa.FreeBatch(ptrs, 6);
+            cout << "Bad pointer in a batch accepted" << endl;
+        }
+        catch (const OAException & e)
+        {
+            cout << "Bad pointer in a batch: " << (e.code() == OAException::E_BAD_BOUNDARY ? "E_BAD_BOUNDARY" : "wrong code") << endl;
+        }
+        PrintCounts(&oa);
+
+        // The rest in one batch
+        oa.FreeBatch(blocks + 3, 13);
+        PrintCounts(&oa);
+
+        // Slab pages give a batch whole runs of their own lists, 20 blocks take 3 pages of 8
+        OAConfig slab(false, 8, 0);
+        slab.DebugOn_ = true;
+        slab.SlabPages_ = true;
+        ObjectAllocator slabs(sizeof(Student), slab);
+        void * many[20];
+        slabs.AllocateBatch(20, many);
+        PrintCounts(&slabs);
+        slabs.FreeBatch(many, 20);
+        try
+        {
+            slabs.Free(many[7]);
+            cout << "Double free after a slab batch accepted" << endl;
+        }
+        catch (const OAException & e)
+        {
+            cout << "Double free after a slab batch: " << (e.code() == OAException::E_MULTIPLE_FREE ? "E_MULTIPLE_FREE" : "wrong code") << endl;
+        }
+        cout << "Pages freed: " << slabs.FreeEmptyPages() << endl;
+        PrintCounts(&slabs);
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestBatches." << endl;
+    }
 }
 
-template <typename T>
-void SwapT(T & a, T & b)
+void TestSizeClasses(void)
 {
-    T temp = a;
-    a      = b;
-    b      = temp;
+    try
+    {
+        SizeClassAllocator sca(DEFAULT_MAX_CLASS_SIZE, OAConfig(false, 16, 0));
+        cout << "Classes: " << sca.ClassCount() << ", max size: " << sca.GetMaxSize() << endl;
+
+        // 8 byte steps up to 64, then four classes per power of two
+        const size_t sizes[] = {1, 8, 9, 64, 65, 80, 81, 129, 1000, 1024, 1025};
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++)
+        {
+            size_t c = sca.ClassOf(sizes[i]);
+            cout << "Size " << sizes[i] << " -> ";
+            if (c == sca.ClassCount())
+                cout << "too big" << endl;
+            else
+                cout << "class " << c << " (" << sca.ClassSize(c) << " bytes)" << endl;
+        }
+
+        // Mixed sizes freed in random order without a size, each goes back to its class
+        std::vector<void *> blocks;
+        for (int i = 0; i < 40; i++)
+            blocks.push_back(sca.Allocate(static_cast<size_t>(i % 4 == 0 ? 65 : i % 4 == 1 ? 24 : i % 4 == 2 ? 500 : 2000)));
+        Shuffle(&blocks[0], static_cast<unsigned>(blocks.size()));
+        for (size_t i = 0; i < blocks.size(); i++)
+            sca.Free(blocks[i]);
+        const size_t used[] = {24, 65, 500};
+        for (size_t i = 0; i < sizeof(used) / sizeof(*used); i++)
+        {
+            OAStats stats = sca.GetClassStats(sca.ClassOf(used[i])).Stats_;
+            cout << "Class of " << used[i] << ": allocs " << stats.Allocations_ << ", frees " << stats.Deallocations_
+                 << ", in use " << stats.ObjectsInUse_ << endl;
+        }
+
+        // Internal fragmentation of 65 byte objects in the 80 byte class
+        SizeClassStats stats = sca.GetClassStats(sca.ClassOf(65));
+        cout << "Requested: " << stats.RequestedBytes_ << ", wasted: " << stats.WastedBytes_
+             << ", fragmentation: " << stats.Fragmentation_ << endl;
+        cout << "Empty pages freed: " << sca.FreeEmptyPages() << endl;
+
+        // Not from the allocator at all, and a class that doesn't exist
+        char local[16];
+        try
+        {
+            sca.Free(local);
+            cout << "Free of a stack address accepted" << endl;
+        }
+        catch (const OAException & e)
+        {
+            cout << "Free of a stack address: " << (e.code() == OAException::E_BAD_BOUNDARY ? "E_BAD_BOUNDARY" : "wrong code") << endl;
+        }
+        try
+        {
+            sca.GetClassStats(sca.ClassCount());
+            cout << "Stats of a class past the last accepted" << endl;
+        }
+        catch (const OAException & e)
+        {
+            cout << "Stats of a class past the last: " << (e.code() == OAException::E_BAD_BOUNDARY ? "E_BAD_BOUNDARY" : "wrong code")
+                 << endl;
+        }
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestSizeClasses." << endl;
+    }
 }
 
-template <typename T>
-void Shuffle(T * array, unsigned count)
+void TestLazyPages(void)
 {
-    for (unsigned int i = 0; i < count; i++)
+    try
     {
-        int r = RandomInt(static_cast<int>(i), static_cast<int>(count) - 1);
-        SwapT(array[i], array[r]);
+        // 8 blocks per page, debug on so uncarved blocks must be skipped by the scans
+        OAConfig config(false, 8, 3, true, 2);
+        config.LazyPages_ = true;
+        ObjectAllocator oa(sizeof(Student), config);
+
+        // Blocks are carved in address order, the free list stays empty until something is freed
+        std::vector<char *> blocks;
+        blocks.push_back(static_cast<char *>(oa.Allocate()));
+        blocks.push_back(static_cast<char *>(oa.Allocate()));
+        size_t stride = static_cast<size_t>(blocks[1] - blocks[0]);
+        bool ordered = true;
+        for (int i = 2; i < 8; i++)
+        {
+            blocks.push_back(static_cast<char *>(oa.Allocate()));
+            ordered = ordered && static_cast<size_t>(blocks[i] - blocks[i - 1]) == stride;
+        }
+        cout << "Carved in address order: " << (ordered ? "yes" : "no") << endl;
+        cout << "Free list empty: " << (oa.GetFreeList() ? "no" : "yes") << endl;
+        PrintCounts(&oa);
+
+        // A second page, its first 3 blocks carved and the rest counted as free
+        for (int i = 0; i < 3; i++)
+            blocks.push_back(static_cast<char *>(oa.Allocate()));
+        PrintCounts(&oa);
+
+        // Freed blocks come back before the next one is carved
+        oa.Free(blocks[2]);
+        oa.Free(blocks[5]);
+        char * a = static_cast<char *>(oa.Allocate());
+        char * b = static_cast<char *>(oa.Allocate());
+        char * c = static_cast<char *>(oa.Allocate());
+        cout << "Freed blocks first (LIFO): " << (a == blocks[5] && b == blocks[2] ? "yes" : "no") << endl;
+        cout << "Then the next carved block: " << (c == blocks[10] + stride ? "yes" : "no") << endl;
+        PrintCounts(&oa);
+
+        // Only carved blocks are scanned
+        cout << "Leaks: " << oa.DumpMemoryInUse(DumpCallback2) << ", corrupted: " << oa.ValidatePages(DumpCallback2) << endl;
+
+        // The half carved page is emptied and freed, the next page carves from its start
+        oa.Free(c);
+        for (int i = 8; i < 11; i++)
+            oa.Free(blocks[i]);
+        cout << "Empty pages freed: " << oa.FreeEmptyPages() << endl;
+        PrintCounts(&oa);
+        char * d = static_cast<char *>(oa.Allocate());
+        char * e = static_cast<char *>(oa.Allocate());
+        cout << "New page carves in order: " << (e - d == static_cast<ptrdiff_t>(stride) ? "yes" : "no") << endl;
+        PrintCounts(&oa);
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestLazyPages." << endl;
     }
 }
 
-template <typename T>
-void PrintArray(T * array, unsigned count)
+// Provider that hands out a few pages from the heap and then returns null
+class LimitedPageProvider : public PageProvider
 {
-    for (unsigned i = 0; i < count; i++)
-        std::cout << array[i] << std::endl;
-}
+  public:
+    explicit LimitedPageProvider(unsigned Pages) : left_(Pages)
+    {
+    }
+    char * AllocatePage(size_t Size)
+    {
+        if (!left_)
+            return nullptr;
+        left_--;
+        return HeapPageProvider::Instance().AllocatePage(Size);
+    }
+    void ReleasePage(char * Page, size_t Size)
+    {
+        HeapPageProvider::Instance().ReleasePage(Page, Size);
+    }
+    size_t Alignment(void) const
+    {
+        return HeapPageProvider::Instance().Alignment();
+    }
 
-const unsigned objects = 4096;
-const unsigned pages   = 100;
-const unsigned total   = objects * pages;
-void *         ptrs[total];
+  private:
+    unsigned left_;
+};
 
-#include <ctime>
-void Stress(bool UseNewDelete)
+void TestPageProviders(void)
 {
-    ObjectAllocator * oa;
+    try
+    {
+        // The arena runs out after a few pages
+        ArenaPageProvider arena(4096);
+        OAConfig config(false, 8, 0);
+        config.PageProvider_ = &arena;
+        ObjectAllocator oa(sizeof(Student), config);
+        std::vector<char *> blocks;
+        try
+        {
+            for (;;)
+                blocks.push_back(static_cast<char *>(oa.Allocate()));
+        }
+        catch (const OAException & e)
+        {
+            cout << "Arena exhausted: " << (e.code() == OAException::E_NO_MEMORY ? "E_NO_MEMORY" : "wrong code") << endl;
+        }
+        OAStats stats = oa.GetStats();
+        cout << "Pages: " << stats.PagesInUse_ << ", page size: " << stats.PageSize_ << ", arena left: " << arena.Available()
+             << " of " << arena.Capacity() << endl;
+        PrintCounts(&oa);
+
+        // The first page is emptied and released, the next page reuses it
+        std::sort(blocks.begin(), blocks.end());
+        std::set<char *> first(blocks.begin(), blocks.begin() + 8);
+        for (int i = 0; i < 8; i++)
+            oa.Free(blocks[i]);
+        cout << "Empty pages freed: " << oa.FreeEmptyPages() << ", arena left: " << arena.Available() << endl;
+        char * reused = static_cast<char *>(oa.Allocate());
+        cout << "Released page reused: " << (first.count(reused) ? "yes" : "no") << endl;
+        PrintCounts(&oa);
+
+        // Everything back, the last pages carved go back to the buffer
+        oa.Free(reused);
+        for (size_t i = 8; i < blocks.size(); i++)
+            oa.Free(blocks[i]);
+        cout << "Empty pages freed: " << oa.FreeEmptyPages() << ", arena left: " << arena.Available() << endl;
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestPageProviders." << endl;
+    }
 
+    // A provider that returns null right away, the constructor can't get its first page
+    LimitedPageProvider none(0);
+    OAConfig config(false, 8, 0);
+    config.PageProvider_ = &none;
     try
     {
-        bool                      newdel   = UseNewDelete;
-        bool                      debug    = false;
-        unsigned                  padbytes = 0;
-        OAConfig::HeaderBlockInfo header(OAConfig::hbNone);
-        unsigned                  alignment = 0;
+        ObjectAllocator oa(sizeof(Student), config);
+        cout << "Construction with a null provider accepted" << endl;
+    }
+    catch (const OAException & e)
+    {
+        cout << "Null provider at construction: " << (e.code() == OAException::E_NO_MEMORY ? "E_NO_MEMORY" : "wrong code")
+             << endl;
+    }
 
-        OAConfig config(newdel, objects, pages, debug, padbytes, header, alignment);
-        oa = new ObjectAllocator(sizeof(Student), config);
-        for (unsigned i = 0; i < total; i++)
+    // One page and then null, the failed Allocate changes nothing
+    LimitedPageProvider one(1);
+    config.PageProvider_ = &one;
+    try
+    {
+        ObjectAllocator oa(sizeof(Student), config);
+        void * blocks[8];
+        oa.AllocateBatch(8, blocks);
+        try
         {
-            void * p = oa->Allocate();
-            ptrs[i]  = p;
+            oa.Allocate();
+            cout << "Allocate from a null provider accepted" << endl;
+        }
+        catch (const OAException & e)
+        {
+            cout << "Null provider: " << (e.code() == OAException::E_NO_MEMORY ? "E_NO_MEMORY" : "wrong code") << endl;
         }
+        PrintCounts(&oa);
+        oa.FreeBatch(blocks, 8);
+        PrintCounts(&oa);
+    }
+    catch (const OAException & e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestPageProviders." << endl;
+    }
+}
 
-        Shuffle(ptrs, total);
-        for (unsigned i = 0; i < total; i++)
+void StressMagazine(unsigned threads)
+{
+    try
+    {
+        // 1024 blocks, every thread churns up to 100 of its own and keeps 10 when it exits
+        OAConfig config(false, 64, 16);
+        MagazineAllocator ma(sizeof(Student), config, 16);
+        std::mutex lock;
+        std::vector<void *> kept;
+        std::atomic<unsigned> stolen(0);
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++)
         {
-            oa->Free(ptrs[i]);
+            workers.push_back(std::thread([&, t]() {
+                std::vector<void *> mine;
+                unsigned seed = 12345 + t;
+                for (unsigned i = 0; i < 20000; i++)
+                {
+                    seed = seed * 1103515245 + 12345;
+                    if (mine.size() < 100 && (mine.empty() || (seed >> 16) % 2))
+                    {
+                        // tag the block with its owner, nobody else may write it while it is handed out
+                        unsigned * block = static_cast<unsigned *>(ma.Allocate());
+                        block[0] = t;
+                        block[1] = i;
+                        mine.push_back(block);
+                    }
+                    else
+                    {
+                        size_t victim = (seed >> 16) % mine.size();
+                        if (static_cast<unsigned *>(mine[victim])[0] != t)
+                            stolen++;
+                        ma.Free(mine[victim]);
+                        mine[victim] = mine.back();
+                        mine.pop_back();
+                    }
+                }
+                while (mine.size() > 10)
+                {
+                    ma.Free(mine.back());
+                    mine.pop_back();
+                }
+                std::lock_guard<std::mutex> guard(lock);
+                kept.insert(kept.end(), mine.begin(), mine.end());
+            }));
         }
+        for (unsigned t = 0; t < threads; t++)
+            workers[t].join();
 
-        delete oa;
+        // The magazines of the threads that exited are back in the depot
+        OAStats stats = ma.GetStats();
+        cout << "Objects in use after the threads exit: " << stats.ObjectsInUse_ << ", kept: " << kept.size() << endl;
+
+        // Everything else comes back exactly once
+        std::set<void *> unique(kept.begin(), kept.end());
+        unsigned handed = 0;
+        try
+        {
+            for (;;)
+            {
+                unique.insert(ma.Allocate());
+                handed++;
+            }
+        }
+        catch (const OAException &)
+        {
+        }
+        cout << "Blocks handed out: " << handed << ", unique with the kept ones: " << unique.size() << " of 1024" << endl;
+        if (stolen || unique.size() != 1024 || handed + kept.size() != 1024)
+            cout << "Lost or duplicated blocks in StressMagazine." << endl;
     }
     catch (const OAException & e)
     {
         if (SHOW_EXCEPTIONS)
             cout << e.what() << endl;
         else
-            cout << "Exception thrown during construction in Stress." << endl;
-
-        return;
+            cout << "Exception thrown during StressMagazine." << endl;
     }
 }
 
@@ -2278,6 +3754,106 @@ int main(int argc, char ** argv)
             TestFreeEmptyPages4();
             cout << endl;
             break;
+        case 22:
+            cout << "============================== Test stress using lock free allocator..." << endl;
+            StressLockFree(8);
+            cout << endl;
+            break;
+        case 23:
+            cout << "============================== Test containers using pool allocator..." << endl;
+            BenchContainers(200000);
+            cout << endl;
+            break;
+        case 24:
+            cout << "============================== Test pmr containers using pool resource..." << endl;
+            BenchPoolResource(100000);
+            cout << endl;
+            break;
+        case 25:
+            cout << "============================== Test typed object pool..." << endl;
+            TestObjectPool(400000);
+            cout << endl;
+            break;
+        case 26:
+            cout << "============================== Test external header labels..." << endl;
+            TestExternalLabels(100000);
+            cout << endl;
+            break;
+        case 27:
+            cout << "============================== Test pattern checks..." << endl;
+            TestPatternChecks();
+            cout << endl;
+            break;
+        case 28:
+            cout << "============================== Test incremental validate..." << endl;
+            TestIncrementalValidate();
+            cout << endl;
+            break;
+        case 29:
+            cout << "============================== Test parallel scans..." << endl;
+            TestParallelScans(256);
+            cout << endl;
+            break;
+        case 30:
+            cout << "============================== Test guard pages..." << endl;
+            TestGuardPages();
+            cout << endl;
+            break;
+        case 31:
+            cout << "============================== Test quarantine..." << endl;
+            TestQuarantine();
+            cout << endl;
+            break;
+        case 32:
+            cout << "============================== Test slab pages..." << endl;
+            TestSlabPages();
+            cout << endl;
+            break;
+        case 33:
+            cout << "============================== Test side headers..." << endl;
+            TestSideHeaders();
+            cout << endl;
+            break;
+        case 34:
+            cout << "============================== Test magazine with quarantine..." << endl;
+            TestMagazineQuarantine();
+            cout << endl;
+            break;
+        case 35:
+            cout << "============================== Test FreeEmptyPages order..." << endl;
+            TestFreeEmptyPagesOrder();
+            cout << endl;
+            break;
+        case 36:
+            cout << "============================== Test page slack..." << endl;
+            TestPageSlack();
+            cout << endl;
+            break;
+        case 37:
+            cout << "============================== Stress magazines..." << endl;
+            StressMagazine(4);
+            cout << endl;
+            break;
+        case 38:
+            cout << "============================== Test batches..." << endl;
+            TestBatches();
+            cout << endl;
+            break;
+        case 39:
+            cout << "============================== Test size classes..." << endl;
+            TestSizeClasses();
+            cout << endl;
+            break;
+        case 40:
+            cout << "============================== Test lazy pages..." << endl;
+            TestLazyPages();
+            cout << endl;
+            break;
+        case 41:
+            cout << "============================== Test page providers..." << endl;
+            TestPageProviders();
+            cout << endl;
+            break;
         default:
             cout << "============================== Students..." << endl;
             DoStudents(0, false);